@@ -15,24 +15,10 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(sources.pri)
+
 SOURCES += \
-    colorpicker.cpp \
-    etab.cpp \
-    main.cpp \
-    mainwindow.cpp \
-    urlpicker.cpp
-
-HEADERS += \
-    colorpicker.h \
-    etab.h \
-    mainwindow.h \
-    urlpicker.h
-
-FORMS += \
-    colorpicker.ui \
-    etab.ui \
-    mainwindow.ui \
-    urlpicker.ui
+    main.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -41,8 +27,6 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 DISTFILES +=
 
-RESOURCES += \
-    resources.qrc
 RESOURCES += qdarkstyle/style.qrc
 
 RC_ICONS = icons/icons8_copybook.ico
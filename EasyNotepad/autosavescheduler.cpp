@@ -0,0 +1,161 @@
+#include "autosavescheduler.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <etab.h>
+
+//How often the queue is checked (ms)
+#define SCHEDULER_TICK 1000
+//Default and minimum time a tab stays dirty before it is saved (ms)
+#define DEFAULT_DELAY 10000
+//Longer delays than this are replaced by saving when idle (ms)
+#define MAX_DELAY 120000
+//No edits for this long counts as idle (ms)
+#define IDLE_TIME 3000
+//Default bytes written per tick. At least one save runs per tick
+#define DEFAULT_BUDGET (4 * 1024 * 1024)
+//Default max share of GUI time used by autosave (percent)
+#define DEFAULT_GUI_SHARE 2.0
+
+AutoSaveScheduler::AutoSaveScheduler(QObject *parent) : QObject(parent)
+{
+    delay = DEFAULT_DELAY;
+    budget = DEFAULT_BUDGET;
+    guiShare = DEFAULT_GUI_SHARE;
+    snapshotLatency = 0;
+    saveLatency = 0;
+    saves = 0;
+
+    timer = new QTimer(this);
+    timer->setInterval(SCHEDULER_TICK);
+    connect(timer, &QTimer::timeout, this, &AutoSaveScheduler::tick);
+}
+
+//Queue tab for saving. A tab that is already queued keeps its place
+void AutoSaveScheduler::markDirty(ETab *tab){
+    //Quick notes are saved to their recovery file
+    if(!tab->fileExists() && tab->getNotePath().isEmpty())
+        return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    ETab *key = tab;
+
+    if(pending.contains(key)){
+        Entry &entry = pending[key];
+        entry.tab = tab;
+        entry.lastEdit = now;
+        return;
+    }
+
+    int wait = delayFor(tab);
+
+    Entry entry;
+    entry.tab = tab;
+    entry.lastEdit = now;
+    entry.idle = (wait < 0);
+    entry.due = now + qMax(wait, 0);
+    pending.insert(key, entry);
+    order.append(key);
+    if(!timer->isActive())
+        timer->start();
+
+    emit delayChanged(tab, wait);
+}
+
+//Delay (ms) before a dirty tab is saved, or -1 if it is only saved when idle
+int AutoSaveScheduler::delayFor(ETab *tab){
+    double cost = tab->getSaveCost();
+
+    //Never saved: estimate from other files of this format
+    if(cost < 0){
+        QString format = formatOf(tab);
+        if(!formatCost.contains(format))
+            return delay;
+
+        cost = formatCost[format] * tab->documentSize() / (1024.0 * 1024.0);
+    }
+
+    //A save of cost ms may run once every cost / share ms
+    double wait = cost * 100.0 / guiShare;
+    if(wait > MAX_DELAY)
+        return -1;
+
+    return qMax(delay, (int)wait);
+}
+
+void AutoSaveScheduler::setDelay(int msec) { delay = msec; }
+void AutoSaveScheduler::setBudget(qint64 bytes) { budget = bytes; }
+void AutoSaveScheduler::setGuiShare(double percent) { guiShare = qBound(0.1, percent, 100.0); }
+void AutoSaveScheduler::recordSaveLatency(qint64 msec) { saveLatency = msec; }
+int AutoSaveScheduler::queueDepth() { return order.size(); }
+
+QString AutoSaveScheduler::stats() {
+    return QString("Autosave queue: %1, saves: %2, last snapshot: %3 ms, last write: %4 ms")
+            .arg(queueDepth()).arg(saves).arg(snapshotLatency).arg(saveLatency);
+}
+
+QString AutoSaveScheduler::formatOf(ETab *tab) {
+    return QFileInfo(tab->getFileName()).suffix().toLower();
+}
+
+//Save due tabs, oldest first, until the budget of this tick is used
+void AutoSaveScheduler::tick(){
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 spent = 0;
+    QList<ETab*> later;
+
+    while(!order.isEmpty() && (spent == 0 || spent < budget)){
+        ETab *key = order.takeFirst();
+        Entry entry = pending.value(key);
+
+        if(entry.tab.isNull()){
+            pending.remove(key);
+            continue;
+        }
+
+        bool ready = entry.idle ? (now - entry.lastEdit >= IDLE_TIME) : (entry.due <= now);
+        if(!ready){
+            later.append(key);
+            continue;
+        }
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        qint64 cost = entry.tab->autoSave();
+
+        //Tab can't be saved right now, try again later
+        if(cost < 0){
+            pending[key].due = now + delay;
+            later.append(key);
+            continue;
+        }
+
+        pending.remove(key);
+        snapshotLatency = elapsed.elapsed();
+        spent += qMax<qint64>(cost, 1);
+        saves++;
+
+        if(cost > 0)
+            measured(entry.tab, snapshotLatency);
+    }
+
+    order = later + order;
+    if(order.isEmpty())
+        timer->stop();
+}
+
+//Remember what a save of this tab cost the GUI thread
+void AutoSaveScheduler::measured(ETab *tab, qint64 msec){
+    double old = tab->getSaveCost();
+    double cost = (old < 0) ? msec : 0.7 * old + 0.3 * msec;
+    tab->setSaveCost(cost);
+
+    double mb = qMax(tab->documentSize() / (1024.0 * 1024.0), 0.01);
+    QString format = formatOf(tab);
+    double perMb = msec / mb;
+    formatCost[format] = formatCost.contains(format) ? 0.7 * formatCost[format] + 0.3 * perMb : perMb;
+
+    emit delayChanged(tab, delayFor(tab));
+}
@@ -0,0 +1,58 @@
+#ifndef AUTOSAVESCHEDULER_H
+#define AUTOSAVESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QPointer>
+#include <QList>
+
+class ETab;
+
+//One timer for all tabs, running while tabs are queued. Dirty tabs are queued once and saved a few
+//per tick, so saves don't pile up in the same event loop iteration.
+//The delay of a tab follows from what its saves cost, so autosave stays
+//under a share of the GUI thread. Too expensive tabs are saved when idle
+class AutoSaveScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutoSaveScheduler(QObject *parent = nullptr);
+    void markDirty(ETab *tab);
+    void setDelay(int msec);
+    void setBudget(qint64 bytes);
+    void setGuiShare(double percent);
+    void recordSaveLatency(qint64 msec);
+    int delayFor(ETab *tab);
+    int queueDepth();
+    QString stats();
+
+signals:
+    void delayChanged(ETab *tab, int msec);
+
+private slots:
+    void tick();
+
+private:
+    struct Entry {
+        QPointer<ETab> tab;
+        qint64 due;
+        qint64 lastEdit;
+        bool idle;
+    };
+    QTimer *timer;
+    QHash<ETab*, Entry> pending; //Coalesced per tab, its file name may change with Save as
+    QList<ETab*> order;
+    QHash<QString, double> formatCost; //ms per MB of document, per file format
+    int delay;
+    qint64 budget;
+    double guiShare;
+    qint64 snapshotLatency; //Of the last autosave on the GUI thread (ms)
+    qint64 saveLatency; //Of the last write in background (ms)
+    int saves;
+    void measured(ETab *tab, qint64 msec);
+    static QString formatOf(ETab *tab);
+};
+
+#endif // AUTOSAVESCHEDULER_H
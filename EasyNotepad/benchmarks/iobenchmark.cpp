@@ -0,0 +1,332 @@
+#include <QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <etab.h>
+#include <fileloader.h>
+#include <mainwindow.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/resource.h>
+#endif
+
+//Environment variables:
+// EASYNOTEPAD_BENCH_OUT     JSON file with the results (default iobenchmark.json)
+// EASYNOTEPAD_BENCH_CORPUS  Folder to keep the generated corpus in between runs
+// EASYNOTEPAD_BENCH_MAX_MB  Skip files bigger than this (default 50, use 500 for all)
+#define DEFAULT_MAX_MB 50
+//Give up waiting for a file to load after this long (ms)
+#define LOAD_TIMEOUT (30 * 60 * 1000)
+
+//Peak resident memory of the process in bytes, -1 if unknown
+static qint64 peakRss(){
+#if defined(Q_OS_LINUX)
+    QFile f("/proc/self/status");
+    if(!f.open(QIODevice::ReadOnly))
+        return -1;
+
+    for(QByteArray line : f.readAll().split('\n')) {
+        if(line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+    }
+    return -1;
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return -1;
+    return pmc.PeakWorkingSetSize;
+#elif defined(Q_OS_MACOS)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
+
+//Start measuring a new peak. Only Linux can do this, elsewhere the peak is of the whole run
+static void resetPeakRss(){
+#if defined(Q_OS_LINUX)
+    QFile f("/proc/self/clear_refs");
+    if(f.open(QIODevice::WriteOnly))
+        f.write("5");
+#endif
+}
+
+//Opening and saving files through ETab, for generated HTML, Markdown,
+//plain text and ODT files of 10 KB up to 500 MB
+class IOBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void read_data();
+    void read();
+    void write_data();
+    void write();
+
+private:
+    QTemporaryDir temp;
+    QString corpusDir;
+    qint64 maxSize;
+    QStringList params;
+    MainWindow *window;
+    QJsonArray results;
+    void addRows();
+    QString corpus(QString format, qint64 size);
+    bool generate(QString fileName, QString format, qint64 size);
+    bool waitLoaded(ETab *tab);
+    void record(QString test, QString format, qint64 size, qint64 bytes, qint64 msec, QJsonObject stages);
+};
+
+void IOBenchmark::initTestCase(){
+    //Keep journals and quick notes of the benchmark away from the real ones
+    QStandardPaths::setTestModeEnabled(true);
+
+    corpusDir = qEnvironmentVariable("EASYNOTEPAD_BENCH_CORPUS", temp.path());
+    QDir().mkpath(corpusDir);
+
+    bool ok;
+    int mb = qEnvironmentVariableIntValue("EASYNOTEPAD_BENCH_MAX_MB", &ok);
+    maxSize = (ok ? mb : DEFAULT_MAX_MB) * 1024LL * 1024LL;
+
+    window = new MainWindow(&params);
+}
+
+void IOBenchmark::cleanupTestCase(){
+    delete window;
+
+    QJsonObject object;
+    object["qt"] = QString(qVersion());
+    object["platform"] = QGuiApplication::platformName();
+    object["results"] = results;
+
+    QString fileName = qEnvironmentVariable("EASYNOTEPAD_BENCH_OUT", "iobenchmark.json");
+    QFile f(fileName);
+    if(!f.open(QIODevice::WriteOnly)){
+        qWarning("Failed to write results to %s", qPrintable(fileName));
+        return;
+    }
+
+    f.write(QJsonDocument(object).toJson());
+    qInfo("Results written to %s", qPrintable(QFileInfo(fileName).absoluteFilePath()));
+}
+
+void IOBenchmark::addRows(){
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<qint64>("size");
+
+    QList<QPair<QString, qint64>> sizes = {
+        {"10KB", 10 * 1024LL},
+        {"1MB", 1024 * 1024LL},
+        {"50MB", 50 * 1024 * 1024LL},
+        {"500MB", 500 * 1024 * 1024LL}
+    };
+
+    for(QString format : {"html", "md", "txt", "odt"}) {
+        for(auto size : sizes) {
+            QTest::newRow(qPrintable(format + "-" + size.first)) << format << size.second;
+        }
+    }
+}
+
+void IOBenchmark::read_data() { addRows(); }
+void IOBenchmark::write_data() { addRows(); }
+
+//Open file: ETab::useFile(false), and streaming for big plain text files
+void IOBenchmark::read(){
+    QFETCH(QString, format);
+    QFETCH(qint64, size);
+
+    if(size > maxSize)
+        QSKIP("Bigger than EASYNOTEPAD_BENCH_MAX_MB");
+    if(format == "odt")
+        QSKIP("ODT files can only be written");
+
+    QString fileName = corpus(format, size);
+    QVERIFY(!fileName.isEmpty());
+
+    QJsonObject stages;
+    QElapsedTimer elapsed;
+    resetPeakRss();
+
+    //What the loader does on a worker: read, decode and parse
+    elapsed.start();
+    LoadResult parsed = FileLoader::read(fileName);
+    stages["parse"] = elapsed.elapsed();
+    delete parsed.document;
+    QVERIFY(parsed.ok);
+
+    ETab *tab = new ETab(window);
+    tab->setFileName(fileName);
+
+    elapsed.restart();
+    tab->openFile();
+    qint64 useFile = elapsed.elapsed();
+    QVERIFY(waitLoaded(tab));
+    qint64 msec = elapsed.elapsed();
+
+    stages["useFile"] = useFile;
+    stages["stream"] = msec - useFile;
+
+    QTest::setBenchmarkResult(msec, QTest::WalltimeMilliseconds);
+    record("read", format, size, QFileInfo(fileName).size(), msec, stages);
+    delete tab;
+}
+
+//Save file: ETab::useFile(true). ODT is written from the plain text corpus
+void IOBenchmark::write(){
+    QFETCH(QString, format);
+    QFETCH(qint64, size);
+
+    if(size > maxSize)
+        QSKIP("Bigger than EASYNOTEPAD_BENCH_MAX_MB");
+
+    QString source = corpus(format == "odt" ? "txt" : format, size);
+    QVERIFY(!source.isEmpty());
+
+    ETab *tab = new ETab(window);
+    tab->setFileName(source);
+    tab->openFile();
+    QVERIFY(waitLoaded(tab));
+
+    //Saving needs an existing file, like Save as does
+    QString fileName = QDir(temp.path()).filePath(QString("saved-%1.%2").arg(size).arg(format));
+    QFile f(fileName);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.close();
+    tab->setFileName(fileName);
+
+    QJsonObject stages;
+    QElapsedTimer elapsed;
+    resetPeakRss();
+
+    //What an autosave does on the GUI thread before writing in background
+    elapsed.start();
+    QTextDocument *snapshot = tab->document()->clone();
+    stages["snapshot"] = elapsed.elapsed();
+    delete snapshot;
+
+    elapsed.restart();
+    tab->saveFile(true);
+    qint64 msec = elapsed.elapsed();
+    stages["useFile"] = msec;
+
+    qint64 bytes = QFileInfo(fileName).size();
+    QVERIFY(bytes > 0);
+
+    QTest::setBenchmarkResult(msec, QTest::WalltimeMilliseconds);
+    record("write", format, size, bytes, msec, stages);
+    delete tab;
+    QFile::remove(fileName);
+}
+
+//Generated file of about size bytes, made once per run or corpus folder
+QString IOBenchmark::corpus(QString format, qint64 size){
+    QString fileName = QDir(corpusDir).filePath(QString("corpus-%1.%2").arg(size).arg(format));
+    if(QFile::exists(fileName))
+        return fileName;
+
+    if(!generate(fileName, format, size))
+        return QString();
+
+    return fileName;
+}
+
+//Write random sentences with headings and formatting, in chunks so big files don't need the memory
+bool IOBenchmark::generate(QString fileName, QString format, qint64 size){
+    static const char *words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "quick", "note", "editor", "tab", "file",
+        "heading", "list", "format", "save", "open", "text", "document", "markdown", "plain", "rich"
+    };
+    const int wordCount = sizeof(words) / sizeof(words[0]);
+
+    QFile f(fileName);
+    if(!f.open(QIODevice::WriteOnly))
+        return false;
+
+    QRandomGenerator random(42);
+    QByteArray chunk;
+    qint64 written = 0;
+
+    if(format == "html")
+        chunk += "<html><body>\n";
+
+    for(int line = 0; written + chunk.size() < size; line++) {
+        QByteArray text;
+        int count = 8 + random.bounded(12);
+        for(int i = 0; i < count; i++) {
+            if(i > 0)
+                text += ' ';
+            text += words[random.bounded(wordCount)];
+        }
+
+        QByteArray word = words[random.bounded(wordCount)];
+        if(format == "html")
+            chunk += (line % 20 == 0) ? "<h2>" + text + "</h2>\n" : "<p>" + text + " <b>" + word + "</b></p>\n";
+        else if(format == "md")
+            chunk += (line % 20 == 0) ? "## " + text + "\n\n" : ((line % 5 == 0) ? "- " + text + "\n\n" : text + " **" + word + "**\n\n");
+        else
+            chunk += text + "\n";
+
+        if(chunk.size() >= 64 * 1024) {
+            written += f.write(chunk);
+            chunk.clear();
+        }
+    }
+
+    if(format == "html")
+        chunk += "</body></html>\n";
+
+    f.write(chunk);
+    return f.error() == QFile::NoError;
+}
+
+//Process events until the tab is done loading
+bool IOBenchmark::waitLoaded(ETab *tab){
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while(tab->isLoading()) {
+        if(elapsed.elapsed() > LOAD_TIMEOUT)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+    return true;
+}
+
+void IOBenchmark::record(QString test, QString format, qint64 size, qint64 bytes, qint64 msec, QJsonObject stages){
+    QJsonObject result;
+    result["test"] = test;
+    result["format"] = format;
+    result["size"] = size;
+    result["bytes"] = bytes;
+    result["msec"] = msec;
+    result["mbPerSec"] = (msec > 0) ? (bytes / (1024.0 * 1024.0)) / (msec / 1000.0) : 0.0;
+    result["peakRss"] = peakRss();
+    result["stages"] = stages;
+    results.append(result);
+}
+
+int main(int argc, char *argv[])
+{
+    //Headless, unless another platform is asked for
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication a(argc, argv);
+    IOBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "iobenchmark.moc"
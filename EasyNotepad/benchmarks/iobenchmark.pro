@@ -0,0 +1,16 @@
+QT       += core gui widgets testlib
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = iobenchmark
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# The benchmark builds the editor sources itself, without main.cpp
+include(../sources.pri)
+
+SOURCES += \
+    iobenchmark.cpp
+
+win32: LIBS += -lpsapi
@@ -0,0 +1,68 @@
+#include "changetracker.h"
+
+#include <QTextBlock>
+#include <QHash>
+
+static const quint64 FNV_OFFSET = 14695981039346656037ULL;
+static const quint64 FNV_PRIME = 1099511628211ULL;
+
+ChangeTracker::ChangeTracker()
+{
+}
+
+//Document and file are the same now
+void ChangeTracker::synced(State state){
+    this->state = state;
+}
+
+//Edited since the last sync. Undoing all edits makes the document clean again
+bool ChangeTracker::isDirty(QTextDocument *document){
+    if(document->revision() == state.revision)
+        return false;
+
+    return document->isModified() || document->characterCount() != state.count;
+}
+
+//Dirty and different from the file. Only hashes when the size didn't change
+bool ChangeTracker::needsWrite(QTextDocument *document){
+    if(!isDirty(document))
+        return false;
+
+    if(document->characterCount() != state.count || !state.hashed)
+        return true;
+
+    return hash(document) != state.hash;
+}
+
+//An empty document still has its closing paragraph separator
+bool ChangeTracker::isEmpty(QTextDocument *document){
+    return document->characterCount() <= 1;
+}
+
+ChangeTracker::State ChangeTracker::stateOf(QTextDocument *document, bool hashed){
+    State result;
+    result.revision = document->revision();
+    result.count = document->characterCount();
+    result.hashed = hashed;
+    if(hashed)
+        result.hash = hash(document);
+
+    return result;
+}
+
+//Rolling hash of text and formats. Equal formats share one index in a document,
+//so the index stands for the format. Only comparable within the same document
+quint64 ChangeTracker::hash(QTextDocument *document){
+    quint64 h = FNV_OFFSET;
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        h = (h ^ (quint64)block.blockFormatIndex()) * FNV_PRIME;
+
+        for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextFragment fragment = it.fragment();
+            h = (h ^ (quint64)fragment.charFormatIndex()) * FNV_PRIME;
+            h = (h ^ (quint64)qHash(fragment.text())) * FNV_PRIME;
+        }
+    }
+
+    return h;
+}
@@ -0,0 +1,31 @@
+#ifndef CHANGETRACKER_H
+#define CHANGETRACKER_H
+
+#include <QTextDocument>
+
+//Remembers the state of a document when it was last written to (or read from) its file.
+//Dirty and empty checks only look at the revision and size. Before a write the content
+//hash tells if the document really differs, e.g. after typing and undoing
+class ChangeTracker
+{
+public:
+    struct State {
+        int revision = -1;
+        int count = 0;
+        quint64 hash = 0;
+        bool hashed = false;
+    };
+
+    ChangeTracker();
+    void synced(State state);
+    bool isDirty(QTextDocument *document);
+    bool needsWrite(QTextDocument *document);
+    static bool isEmpty(QTextDocument *document);
+    static State stateOf(QTextDocument *document, bool hashed = true);
+    static quint64 hash(QTextDocument *document);
+
+private:
+    State state;
+};
+
+#endif // CHANGETRACKER_H
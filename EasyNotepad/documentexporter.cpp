@@ -0,0 +1,172 @@
+#include "documentexporter.h"
+
+#include <QTextCursor>
+#include <QTextDocumentFragment>
+#include <QTextFrame>
+#include <QTextList>
+#include <QTextTable>
+
+//Characters per part. A part only ends between blocks, so one long block is a part of its own
+#define PART_SIZE (64 * 1024)
+//Characters after which a part ends even inside a table or a list that is not split otherwise
+#define MAX_PART_SIZE (16 * PART_SIZE)
+
+//Format by file suffix or QTextDocumentWriter format name. Everything else is for QTextDocumentWriter
+DocumentExporter::Format DocumentExporter::formatOf(QByteArray format){
+    format = format.toLower();
+    if(format == "txt" || format == "text" || format == "plaintext")
+        return PLAINTEXT;
+    if(format == "htm" || format == "html")
+        return HTML;
+    if(format == "md" || format == "markdown")
+        return MARKDOWN;
+    return UNKNOWN;
+}
+
+bool DocumentExporter::write(QTextDocument *document, QIODevice *device, Format format){
+    switch (format) {
+    case PLAINTEXT:
+        return writePlainText(document, device);
+    case HTML:
+        return writeHtml(document, device);
+    case MARKDOWN:
+        return writeMarkdown(document, device);
+    default:
+        return false;
+    }
+}
+
+//Encode and write what is buffered
+bool DocumentExporter::flush(QIODevice *device, QString &buffer){
+    QByteArray data = buffer.toUtf8();
+    buffer.clear();
+    return device->write(data) == data.size();
+}
+
+//Last block of the part that starts at the block. Tables and nested lists are not split,
+//else they would be written as two, nor lists at all unless they can be reopened. Past
+//MAX_PART_SIZE the part ends anyway
+QTextBlock DocumentExporter::partEnd(QTextBlock first, bool splitLists){
+    int size = 0;
+    QTextBlock block = first;
+    while(true){
+        size += block.length();
+        QTextBlock next = block.next();
+        if(!next.isValid() || size >= MAX_PART_SIZE)
+            return block;
+
+        if(size >= PART_SIZE && QTextCursor(next).currentTable() == nullptr && QTextCursor(block).currentTable() == nullptr){
+            QTextList *list = next.textList();
+            if(list == nullptr || (splitLists && list->format().indent() <= 1))
+                return block;
+        }
+
+        block = next;
+    }
+}
+
+//Same text as toPlainText(), block by block
+bool DocumentExporter::writePlainText(QTextDocument *document, QIODevice *device){
+    QString buffer;
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next()){
+        if(block != document->begin())
+            buffer += QLatin1Char('\n');
+
+        QString text = block.text();
+        text.replace(QChar::Nbsp, QLatin1Char(' '));
+        text.replace(QChar::LineSeparator, QLatin1Char('\n'));
+        buffer += text;
+
+        if(buffer.size() >= PART_SIZE && !flush(device, buffer))
+            return false;
+    }
+
+    return flush(device, buffer);
+}
+
+//Head and body tag of the document, then the HTML of each part as fragment. A part
+//starting inside a numbered list reopens it at the number of its first item
+bool DocumentExporter::writeHtml(QTextDocument *document, QIODevice *device){
+    static const QString START = QStringLiteral("<!--StartFragment-->");
+    static const QString END = QStringLiteral("<!--EndFragment-->");
+
+    //An empty document with the same defaults has the same head
+    QTextDocument head;
+    head.setDefaultFont(document->defaultFont());
+    head.setDefaultStyleSheet(document->defaultStyleSheet());
+    head.setMetaInformation(QTextDocument::DocumentTitle, document->metaInformation(QTextDocument::DocumentTitle));
+    head.rootFrame()->setFrameFormat(document->rootFrame()->frameFormat());
+    QString html = head.toHtml("UTF-8");
+    int body = html.indexOf(QLatin1String("<body"));
+    int bodyEnd = body < 0 ? -1 : html.indexOf(QLatin1Char('>'), body);
+    if(bodyEnd < 0)
+        return false;
+
+    QString buffer = html.left(bodyEnd + 1);
+    html.clear();
+
+    for(QTextBlock first = document->begin(); first.isValid(); ){
+        QTextBlock last = partEnd(first, true);
+        QTextCursor cursor(document);
+        cursor.setPosition(first.position());
+        cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+
+        if(cursor.hasSelection()){
+            QString part = QTextDocumentFragment(cursor).toHtml("UTF-8");
+            int from = part.indexOf(START);
+            from = from < 0 ? part.indexOf(QLatin1Char('>'), part.indexOf(QLatin1String("<body"))) + 1 : from + START.size();
+            int to = part.lastIndexOf(END);
+            to = to < 0 ? part.lastIndexOf(QLatin1String("</body>")) : to;
+
+            //The fragment numbers its list from 1
+            int tag = part.indexOf(QLatin1Char('<'), from);
+            int item = first.textList() ? first.textList()->itemNumber(first) : 0;
+            if(item > 0 && tag >= 0 && tag < to && part.midRef(tag, 3) == QLatin1String("<ol")){
+                QString start = QString(" start=\"%1\"").arg(item + 1);
+                part.insert(tag + 3, start);
+                to += start.size();
+            }
+
+            buffer += part.midRef(from, qMax(0, to - from));
+        } else {
+            //Only empty blocks
+            for(QTextBlock block = first; block != last.next(); block = block.next())
+                buffer += QLatin1String("<p><br /></p>\n");
+        }
+
+        if(!flush(device, buffer))
+            return false;
+
+        first = last.next();
+    }
+
+    buffer += QLatin1String("</body></html>");
+    return flush(device, buffer);
+}
+
+//Markdown of each part, converted in a small document of its own
+bool DocumentExporter::writeMarkdown(QTextDocument *document, QIODevice *device){
+    QString buffer;
+    for(QTextBlock first = document->begin(); first.isValid(); ){
+        QTextBlock last = partEnd(first, false);
+        QTextCursor cursor(document);
+        cursor.setPosition(first.position());
+        cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+
+        //Parts are paragraphs apart
+        if(first != document->begin())
+            buffer += QLatin1Char('\n');
+
+        QTextDocument part;
+        part.setDefaultFont(document->defaultFont());
+        QTextCursor(&part).insertFragment(QTextDocumentFragment(cursor));
+        buffer += part.toMarkdown();
+
+        if(!flush(device, buffer))
+            return false;
+
+        first = last.next();
+    }
+
+    return flush(device, buffer);
+}
@@ -0,0 +1,29 @@
+#ifndef DOCUMENTEXPORTER_H
+#define DOCUMENTEXPORTER_H
+
+#include <QIODevice>
+#include <QTextDocument>
+#include <QTextBlock>
+
+//Writes a document as plain text, HTML or Markdown, a few blocks at a time. Each
+//part is serialized, encoded and written before the next one, so saving takes
+//memory for one part instead of several copies of the whole document. Parts end
+//between blocks; HTML lists are split at items, but tables and Markdown lists stay
+//whole up to a maximum part size, above which they are written as two
+class DocumentExporter
+{
+public:
+    enum Format { PLAINTEXT, HTML, MARKDOWN, UNKNOWN };
+
+    static Format formatOf(QByteArray format);
+    static bool write(QTextDocument *document, QIODevice *device, Format format);
+
+private:
+    static bool writePlainText(QTextDocument *document, QIODevice *device);
+    static bool writeHtml(QTextDocument *document, QIODevice *device);
+    static bool writeMarkdown(QTextDocument *document, QIODevice *device);
+    static QTextBlock partEnd(QTextBlock first, bool splitLists);
+    static bool flush(QIODevice *device, QString &buffer);
+};
+
+#endif // DOCUMENTEXPORTER_H
@@ -0,0 +1,61 @@
+#ifndef DOCUMENTSTATS_H
+#define DOCUMENTSTATS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QVector>
+
+//Word, character, line and paragraph counts of a document. Counts are kept per block,
+//an edit only recounts the blocks it touched. Edits that add or remove blocks splice the
+//per block array, which is linear in the blocks after them. The first count of a big
+//document runs on a worker thread
+class DocumentStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Totals {
+        qint64 words = 0;
+        qint64 characters = 0;
+        int lines = 0;
+        int paragraphs = 0;
+        int readingMinutes() const;
+    };
+
+    explicit DocumentStats(QObject *parent = nullptr);
+    ~DocumentStats();
+    void setDocument(QTextDocument *document);
+    Totals totals();
+    bool isCounting();
+    QString toString();
+
+signals:
+    void changed();
+
+private slots:
+    void contentsChange(int position, int removed, int added);
+
+private:
+    //Counts of one block
+    struct Block {
+        qint32 words = 0;
+        bool paragraph = false; //Has text other than whitespace
+    };
+
+    QPointer<QTextDocument> document;
+    QThreadPool *pool;
+    QVector<Block> blocks;
+    qint64 words;
+    int paragraphs;
+    int generation; //Of the running full count, older results are dropped
+    bool counting;
+    bool stale; //Document changed while it was counted
+    void recount();
+    void counted(QVector<Block> result, int generation);
+    static Block countBlock(const QChar *data, int length);
+    static QVector<Block> countText(const QString &text, int blockCount);
+};
+
+#endif // DOCUMENTSTATS_H
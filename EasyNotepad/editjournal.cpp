@@ -0,0 +1,305 @@
+#include "editjournal.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QVector>
+#include <iostream>
+
+static const quint32 JOURNAL_MAGIC = 0x454E504A; //ENPJ
+//Version 1 has no plain flag. Rich entries of versions 1 and 2 carry only the format of the
+//first char and of its block, from version 3 on every format run and every block
+static const quint32 JOURNAL_VERSION = 3;
+
+EditJournal::EditJournal()
+{
+    this->written = 0;
+    this->baseSize = 0;
+    this->baseModified = 0;
+    this->active = false;
+    this->compacting = false;
+    this->plain = false;
+    this->plainEntries = false;
+    this->entryVersion = JOURNAL_VERSION;
+}
+
+//One journal per file, in the app data folder
+QString EditJournal::journalPath(QString fileName){
+    QString dir = QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QDir::separator() + "journal");
+    QDir().mkpath(dir);
+
+    QByteArray key = QCryptographicHash::hash(QFileInfo(fileName).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+    return dir + QDir::separator() + QString::fromLatin1(key) + ".journal";
+}
+
+//Remember the file the edits apply to
+void EditJournal::readBase(){
+    QFileInfo info(fileName);
+    baseSize = info.size();
+    baseModified = info.lastModified().toMSecsSinceEpoch();
+}
+
+//File and document are the same now: drop old journal and record from here
+void EditJournal::start(QString fileName){
+    this->fileName = fileName;
+    path = journalPath(fileName);
+    QFile::remove(path);
+
+    pending.clear();
+    written = 0;
+    compacting = false;
+    plainEntries = plain;
+    entryVersion = JOURNAL_VERSION;
+    readBase();
+    active = true;
+}
+
+//Stop recording, e.g. while the document is replaced
+void EditJournal::stop(){
+    active = false;
+    pending.clear();
+}
+
+//Apply journal of a crashed session to the freshly loaded document. Returns true if edits were restored
+bool EditJournal::replay(QString fileName, QTextDocument *document){
+    this->fileName = fileName;
+    path = journalPath(fileName);
+    pending.clear();
+    written = 0;
+    compacting = false;
+    active = false;
+
+    QFile f(path);
+    if(!f.exists() || !f.open(QIODevice::ReadWrite))
+        return false;
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic, version;
+    QString name;
+    qint64 size, modified;
+    plainEntries = false;
+    in >> magic >> version >> name >> size >> modified;
+    if(version >= 2)
+        in >> plainEntries;
+
+    //Journal is only valid for the exact file it was written for
+    readBase();
+    if(in.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || version > JOURNAL_VERSION || size != baseSize || modified != baseModified){
+        f.close();
+        f.remove();
+        return false;
+    }
+
+    bool runs = version >= 3;
+    entryVersion = version;
+    int count = 0;
+    qint64 good = f.pos();
+    QTextCursor cursor(document);
+    cursor.beginEditBlock(); //Undo reverts the whole replay
+
+    while(!in.atEnd()){
+        qint32 position, removed;
+        QString text;
+        QTextFormat charFormat, blockFormat;
+        QVector<qint32> offsets, lengths;
+        QVector<QTextFormat> charFormats, blockFormats;
+        in >> position >> removed >> text;
+        if(!plainEntries && runs)
+            in >> offsets >> lengths >> charFormats >> blockFormats;
+        else if(!plainEntries)
+            in >> charFormat >> blockFormat;
+
+        //Last entry was cut off by the crash
+        if(in.status() != QDataStream::Ok)
+            break;
+
+        int last = document->characterCount() - 1;
+        cursor.setPosition(qBound(0, (int)position, last));
+        cursor.setPosition(qBound(0, (int)(position + removed), last), QTextCursor::KeepAnchor);
+        if(cursor.hasSelection())
+            cursor.removeSelectedText();
+        if(!text.isEmpty() && (plainEntries || runs))
+            cursor.insertText(text);
+        else if(!text.isEmpty())
+            cursor.insertText(text, charFormat.toCharFormat());
+
+        if(plainEntries){
+            good = f.pos();
+            count++;
+            continue;
+        }
+
+        if(runs){
+            last = document->characterCount() - 1;
+            for(int i = 0; i < charFormats.size() && i < offsets.size() && i < lengths.size(); i++){
+                cursor.setPosition(qBound(0, (int)(position + offsets[i]), last));
+                cursor.setPosition(qBound(0, (int)(position + offsets[i] + lengths[i]), last), QTextCursor::KeepAnchor);
+                cursor.setCharFormat(charFormats[i].toCharFormat());
+            }
+
+            //List membership is not journaled, so keep each block in its current list
+            QTextBlock block = document->findBlock(qBound(0, (int)position, last));
+            for(const QTextFormat &format : blockFormats){
+                if(!block.isValid())
+                    break;
+
+                QTextBlockFormat blockFormat = format.toBlockFormat();
+                blockFormat.setObjectIndex(block.blockFormat().objectIndex());
+                cursor.setPosition(block.position());
+                cursor.setBlockFormat(blockFormat);
+                block = block.next();
+            }
+
+            good = f.pos();
+            count++;
+            continue;
+        }
+
+        //List membership is not journaled, so keep the block in its current list
+        QTextBlockFormat format = blockFormat.toBlockFormat();
+        format.clearProperty(QTextFormat::ObjectIndex);
+        cursor.setPosition(qBound(0, (int)position, document->characterCount() - 1));
+        cursor.mergeBlockFormat(format);
+
+        good = f.pos();
+        count++;
+    }
+
+    cursor.endEditBlock();
+
+    //Drop broken tail, so new entries can be appended
+    if(good < f.size())
+        f.resize(good);
+
+    //New entries are appended in the format of the ones that are there
+    written = good;
+    f.close();
+    active = true;
+
+    std::cout << "INFO: Replayed " << count << " edits from journal" << std::endl;
+    return count > 0;
+}
+
+//Remember an edit. Called for every contentsChange of the document
+void EditJournal::record(QTextDocument *document, int position, int removed, int added){
+    if(!active)
+        return;
+
+    int last = document->characterCount() - 1;
+    int end = qMin(position + added, last);
+
+    QTextCursor cursor(document);
+    cursor.setPosition(qMin(position, end));
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+
+    QDataStream out(&pending, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_15);
+    if(plainEntries){
+        out << (qint32)position << (qint32)removed << text;
+        return;
+    }
+
+    //Journal of an older version, new entries are appended the way its entries are
+    if(entryVersion < 3){
+        QTextCursor at(document);
+        at.setPosition(qMin(position + 1, last));
+        out << (qint32)position << (qint32)removed << text << at.charFormat() << document->findBlock(position).blockFormat();
+        return;
+    }
+
+    //Every format run of the inserted text and the format of every block it is in, so
+    //mixed pastes and changes of the format only come back as they were
+    QVector<qint32> offsets, lengths;
+    QVector<QTextFormat> charFormats, blockFormats;
+    for(QTextBlock block = document->findBlock(position); block.isValid() && block.position() <= end; block = block.next()){
+        blockFormats.append(block.blockFormat());
+        for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it){
+            QTextFragment fragment = it.fragment();
+            int from = qMax(fragment.position(), position);
+            int to = qMin(fragment.position() + fragment.length(), end);
+            if(from >= to)
+                continue;
+
+            offsets.append(from - position);
+            lengths.append(to - from);
+            charFormats.append(fragment.charFormat());
+        }
+    }
+    out << (qint32)position << (qint32)removed << text << offsets << lengths << charFormats << blockFormats;
+}
+
+//Append recorded edits to the journal file
+bool EditJournal::flush(){
+    if(!active || compacting || pending.isEmpty())
+        return true;
+
+    QFile f(path);
+    if(!f.open(QIODevice::WriteOnly | QIODevice::Append)){
+        std::cerr << "ERROR: Failed to write journal" << std::endl;
+        return false;
+    }
+
+    if(written == 0){
+        f.resize(0);
+        QDataStream out(&f);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << JOURNAL_MAGIC << JOURNAL_VERSION << fileName << baseSize << baseModified << plainEntries;
+    }
+
+    f.write(pending);
+    f.flush();
+    written = f.size();
+    f.close();
+
+    pending.clear();
+    return true;
+}
+
+bool EditJournal::hasEntries() {
+    return written > 0 || !pending.isEmpty();
+}
+
+qint64 EditJournal::size() {
+    return written + pending.size();
+}
+
+qint64 EditJournal::pendingSize() {
+    return pending.size();
+}
+
+//File is rewritten in background. New edits are kept in memory until that is done
+void EditJournal::beginCompaction(){
+    flush();
+    compacting = true;
+}
+
+//Rewrite is done. On success the old journal is obsolete
+void EditJournal::endCompaction(bool ok){
+    if(!compacting)
+        return;
+
+    compacting = false;
+    if(ok){
+        QFile::remove(path);
+        written = 0;
+        plainEntries = plain;
+        entryVersion = JOURNAL_VERSION;
+        readBase();
+    }
+
+    flush();
+}
+
+//Plain text documents have no formats worth journaling, entries are just position and text
+void EditJournal::setPlain(bool plain){
+    this->plain = plain;
+}
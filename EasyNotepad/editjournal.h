@@ -0,0 +1,43 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QTextDocument>
+
+//Append-only log of the edits made to a file since it was last written.
+//Autosave appends the edits instead of rewriting the file. After a crash
+//the log is replayed on top of the file, as long as the file didn't change
+class EditJournal
+{
+public:
+    EditJournal();
+    void start(QString fileName);
+    void stop();
+    bool replay(QString fileName, QTextDocument *document);
+    void record(QTextDocument *document, int position, int removed, int added);
+    bool flush();
+    bool hasEntries();
+    qint64 size();
+    qint64 pendingSize();
+    void beginCompaction();
+    void endCompaction(bool ok);
+    void setPlain(bool plain);
+
+private:
+    QString fileName;
+    QString path;
+    QByteArray pending;
+    qint64 written;
+    qint64 baseSize;
+    qint64 baseModified;
+    bool active;
+    bool compacting;
+    bool plain; //Document is plain text
+    bool plainEntries; //Entries of the journal file carry no formats
+    quint32 entryVersion; //Version the entries of the journal file are written in
+    static QString journalPath(QString fileName);
+    void readBase();
+};
+
+#endif // EDITJOURNAL_H
@@ -7,13 +7,26 @@
 #include <QFile>
 #include <QTextDocumentWriter>
 #include <QTextCodec>
-#include <QMimeDatabase>
 #include <QTextStream>
 #include <QTextListFormat>
 #include <QTextList>
+#include <QPlainTextDocumentLayout>
 
 #include <colorpicker.h>
 #include <urlpicker.h>
+#include <filesaver.h>
+#include <notestore.h>
+#include <documentexporter.h>
+#include <textdecoder.h>
+#include <fileclassifier.h>
+#include <imageloader.h>
+
+//Journal size (bytes) after which the file is rewritten and the journal dropped
+#define JOURNAL_LIMIT (1024 * 1024)
+//Time (ms) after the last edit before find highlights are updated
+#define FIND_DELAY 150
+//Matches that are highlighted at most, the rest is only counted
+#define MAX_HIGHLIGHTS 10000
 
 ETab::ETab(MainWindow *mainwindow, QWidget *parent) : QWidget(parent), ui(new Ui::ETab)
 {
@@ -24,20 +37,140 @@ ETab::ETab(MainWindow *mainwindow, QWidget *parent) : QWidget(parent), ui(new Ui
     QFont font("Consolas", 14);
     ui->textEdit->setFont(font);
 
-    timer = new QTimer();
-    connect(timer, &QTimer::timeout, this, &ETab::timerTick);
     changes = false;
+    autosave = false;
+    dontSave = false;
+
+    //Streaming loader for big plain text files
+    streamer = new FileStreamer(this);
+    connect(streamer, &FileStreamer::progress, this, &ETab::streamProgress);
+    connect(streamer, &FileStreamer::finished, this, &ETab::streamFinished);
+    viewer = nullptr;
+    plainEdit = nullptr;
+    plainText = false;
+
+    progress = new QProgressBar(this);
+    progress->setRange(0, 100);
+    progress->setTextVisible(false);
+    progress->setMaximumHeight(6);
+    progress->hide();
+    ui->gridLayout->addWidget(progress, 1, 0);
+
+    //Find and replace
+    finder = new FindEngine(this);
+    connect(finder, &FindEngine::found, this, &ETab::matchesFound);
+    connect(finder, &FindEngine::finished, this, &ETab::matchesFinished);
+
+    findBar = new FindBar(this);
+    connect(findBar, &FindBar::patternChanged, this, &ETab::findChanged);
+    connect(findBar, &FindBar::findNext, this, &ETab::findNext);
+    connect(findBar, &FindBar::replace, this, &ETab::replace);
+    connect(findBar, &FindBar::replaceAll, this, &ETab::replaceAll);
+    connect(findBar, &FindBar::closed, this, &ETab::closeFind);
+    ui->gridLayout->addWidget(findBar, 2, 0);
+
+    findTimer = new QTimer(this);
+    findTimer->setSingleShot(true);
+    findTimer->setInterval(FIND_DELAY);
+    connect(findTimer, &QTimer::timeout, this, &ETab::updateFind);
+
+    placeholder = ui->textEdit->placeholderText();
+    pendingLoad = false;
+    locked = false;
+    stub = false;
+    noteDirty = false;
+    hitPending = false;
+    saveCost = -1;
+    syncedSize = -1;
+
+    //Edits are journaled once the tab is backed by a file
+    journal = new EditJournal();
+    connect(ui->textEdit->document(), &QTextDocument::contentsChange, this, &ETab::contentsChange);
+
+    //What was last read from or written to the file
+    tracker = new ChangeTracker();
+
+    //Counts for the status bar, kept up to date per edited block
+    stats = new DocumentStats(this);
+    stats->setDocument(ui->textEdit->document());
+    connect(stats, &DocumentStats::changed, this, &ETab::statsChanged);
+
+    //Headings for the outline panel. Plain text has none
+    headings = new OutlineIndex(this);
+    headings->setDocument(ui->textEdit->document());
 }
 
 ETab::~ETab()
 {
+    delete streamer; //Before the document is gone
+    delete stats;
+    delete journal;
+    delete tracker;
     delete ui;
-    delete timer;
     delete file;
 }
 
 void ETab::focus() {
-    ui->textEdit->setFocus();
+    if(viewer != nullptr)
+        viewer->setFocus();
+    else
+        editor()->setFocus();
+}
+
+//Plain text files are edited in a QPlainTextEdit. It lays out only the blocks that are shown and
+//has no rich text bookkeeping, so editing big files stays fast. Rich files use the rich text editor
+void ETab::usePlainEditor(bool plain){
+    if(plain == plainText)
+        return;
+
+    if(plain && plainEdit == nullptr){
+        plainEdit = new QPlainTextEdit(this);
+        plainEdit->setFrameStyle(QFrame::NoFrame);
+        plainEdit->setStyleSheet(ui->textEdit->styleSheet());
+        plainEdit->setFont(ui->textEdit->font());
+        plainEdit->setPlaceholderText(placeholder);
+        connect(plainEdit, &QPlainTextEdit::textChanged, this, &ETab::on_textEdit_textChanged);
+        connect(plainEdit, &QPlainTextEdit::cursorPositionChanged, this, &ETab::on_textEdit_cursorPositionChanged);
+        connect(plainEdit->document(), &QTextDocument::contentsChange, this, &ETab::contentsChange);
+        ui->gridLayout->addWidget(plainEdit, 0, 0);
+    }
+
+    bool focused = editor()->hasFocus();
+    editor()->hide();
+    plainText = plain;
+    journal->setPlain(plain);
+    editor()->show();
+    if(focused)
+        editor()->setFocus();
+}
+
+//Editor that is in use
+QAbstractScrollArea *ETab::editor() {
+    if(plainText)
+        return plainEdit;
+    return ui->textEdit;
+}
+
+QTextDocument *ETab::document() {
+    return plainText ? plainEdit->document() : ui->textEdit->document();
+}
+
+QTextCursor ETab::textCursor() {
+    return plainText ? plainEdit->textCursor() : ui->textEdit->textCursor();
+}
+
+void ETab::setTextCursor(const QTextCursor &cursor){
+    if(plainText)
+        plainEdit->setTextCursor(cursor);
+    else
+        ui->textEdit->setTextCursor(cursor);
+}
+
+void ETab::setPlaceholder(QString text){
+    if(plainText)
+        plainEdit->setPlaceholderText(text);
+    else
+        ui->textEdit->setPlaceholderText(text);
 }
 
 
@@ -47,11 +180,16 @@ void ETab::focus() {
 
 
 void ETab::on_textEdit_currentCharFormatChanged(const QTextCharFormat &format) { main->updateActions(format); }
-void ETab::on_textEdit_textChanged() { changes = true; }
+void ETab::on_textEdit_textChanged() {
+    changes = true;
+    noteDirty = true;
+    if(autosave || !notePath.isEmpty())
+        main->scheduleAutoSave(this);
+}
 
 void ETab::on_textEdit_cursorPositionChanged()
 {
-    QTextCursor cursor = ui->textEdit->textCursor();
+    QTextCursor cursor = textCursor();
     if(main != NULL){
         main->updateStatusLabel((cursor.blockNumber()+1), (cursor.columnNumber()+1));
     } else{
@@ -59,14 +197,21 @@ void ETab::on_textEdit_cursorPositionChanged()
     }
 }
 
-void ETab::timerTick(){
-    if(!autosave){
-        timer->stop();
-    } else{
-        if(changes){
-            useFile(true);
-        }
-    }
+void ETab::streamProgress(int percent) { progress->setValue(percent); }
+
+void ETab::streamFinished(bool ok){
+    progress->hide();
+    lockEditor(false);
+    stats->setDocument(document());
+
+    //Streamed content is the file content, so nothing to save. Not hashed, that would take another pass
+    fileSynced(ChangeTracker::stateOf(document(), false));
+    if(ok){
+        replayJournal();
+        selectPending();
+        main->updateMessage(" \U0001F5CE "+getName()+" loaded!");
+    } else
+        std::cout << "WARNING: Loading file was cancelled" << std::endl;
 }
 
 
@@ -75,18 +220,110 @@ void ETab::timerTick(){
  */
 
 void ETab::setContent(QString text, bool doSave) {
-    ui->textEdit->setHtml(text);
+    markdown = MarkdownImporter::Index();
+    encoding.clear();
+
+    //Parsed apart from the editor, so images are placeholders before the first layout
+    QTextDocument *doc = new QTextDocument();
+    doc->setHtml(text);
+    ImageLoader::load(doc, ui->textEdit->devicePixelRatioF());
+    useDocument(doc, false);
+    on_textEdit_textChanged(); //As setHtml on the editor did
     this->dontSave = !doSave;
 }
 
 QString ETab::getContent() {
-    return ui->textEdit->toHtml();
+    if(stub)
+        return stubContent;
+
+    return document()->toHtml();
+}
+
+//Restored tab: keep only the file name or the saved content until it is opened
+void ETab::setStub(QString content){
+    stub = true;
+    stubContent = content;
+}
+
+bool ETab::isStub() {
+    return stub;
+}
+
+//Load content of a restored tab. Without loader files are read at once
+void ETab::materialize(FileLoader *loader){
+    if(!stub)
+        return;
+
+    stub = false;
+    //Content of old sessions is not in the recovery store yet
+    bool legacy = !stubContent.isEmpty();
+    if(fileExists()){
+        if(!FileClassifier::classify(getFileName()).view || !viewFile()){
+            if(loader != nullptr)
+                openFile(loader);
+            else
+                openFile();
+        }
+    } else if(legacy)
+        setContent(stubContent);
+    else if(!notePath.isEmpty())
+        setContent(NoteStore::read(notePath));
+
+    noteDirty = legacy;
+    stubContent.clear();
+}
+
+//Show a file that is too big for the editor in the read only viewer
+bool ETab::viewFile(){
+    viewer = new LargeFileView(this);
+    viewer->setFont(ui->textEdit->font());
+    if(!viewer->open(file->fileName())){
+        delete viewer;
+        viewer = nullptr;
+        return false;
+    }
+
+    connect(viewer, &LargeFileView::found, this, &ETab::viewerFound);
+    connect(viewer, &LargeFileView::indexed, this, &ETab::viewerIndexed);
+    connect(viewer, &LargeFileView::lineChanged, this, &ETab::viewerScrolled);
+
+    journal->stop();
+    headings->setDocument(nullptr);
+    editor()->hide();
+    ui->gridLayout->addWidget(viewer, 0, 0);
+    main->updateMessage(" \U0001F5CE "+getName()+" is too big to edit, it is shown read only");
+    return true;
+}
+
+bool ETab::isViewer() {
+    return viewer != nullptr;
+}
+
+void ETab::viewerFound(bool ok) { findBar->setStatus(ok ? QString() : QString("No matches")); }
+void ETab::viewerIndexed(int lines) {
+    main->updateMessage(QString(" \U0001F5CE %1: %2 lines").arg(getName()).arg(lines));
+    main->updateStatistics(this);
+}
+void ETab::viewerScrolled(int line) { main->updateStatusLabel(line + 1, 1); }
+
+void ETab::statsChanged() { main->updateStatistics(this); }
+
+QString ETab::statistics() {
+    if(viewer != nullptr)
+        return QString("%1 lines ").arg(viewer->lineCount());
+    if(!encoding.isEmpty())
+        return encoding + ", " + stats->toString();
+    return stats->toString();
 }
 
 //Set font format on selected tab
 void ETab::setFontFormat(const QTextCharFormat &format){
+    //Plain text has no formats
+    if(plainText)
+        return;
+
     //Get cursor and set charFormat
-    QTextCursor cursor = ui->textEdit->textCursor();
+    QTextCursor cursor = textCursor();
     cursor.mergeCharFormat(format);
     ui->textEdit->mergeCurrentCharFormat(format);
 }
@@ -94,65 +331,66 @@ void ETab::setFontFormat(const QTextCharFormat &format){
 //Enable/disable autosave on file
 void ETab::setAutoSave(bool enabled){
     autosave = enabled;
-    if(enabled == true && !timer->isActive()){
-        timer->start(10000);
+    if(enabled && changes){
+        main->scheduleAutoSave(this);
     }
 }
 
 //Write/read file
-void ETab::useFile(bool write){
+//Returns false if the file wasn't read or written
+bool ETab::useFile(bool write){
+    //Never write a partially loaded or not yet loaded document back
+    if(write && (stub || isLoading() || viewer != nullptr))
+        return false;
+
     if(!file->exists()){
         std::cout << "WARNING: File does not exist!" << std::endl;
-        return;
+        return false;
     }
 
     if(!write){
-        //Read data from file
-        if(!file->open(QIODevice::ReadOnly)){
-            std::cerr << "ERROR: Failed to read file" << std::endl;
-            return;
-        }
-
-        //Use mimetypes. Can also check on endsWith
-        QByteArray data = file->readAll();
-        QTextCodec *codec = Qt::codecForHtml(data);
-        QString str = codec->toUnicode(data);
-        QUrl baseUrl = (file->fileName().front() == QLatin1Char(':') ? QUrl(file->fileName()) : QUrl::fromLocalFile(file->fileName())).adjusted(QUrl::RemoveFilename);
-        ui->textEdit->document()->setBaseUrl(baseUrl);
-        if (Qt::mightBeRichText(str)) {
-            ui->textEdit->setHtml(str);
-        } else {
-            QMimeDatabase db;
-            if (db.mimeTypeForFileNameAndData(file->fileName(), data).name() == QLatin1String("text/markdown")){
-                ui->textEdit->setMarkdown(str);
-            }
-            else
-                ui->textEdit->setPlainText(QString::fromLocal8Bit(data));
-        }
+        //Read, decode and parse. FileLoader does this on a worker thread when opening tabs
+        LoadResult result = FileLoader::read(file->fileName());
+        setLoaded(result);
+        return result.ok;
     } else{
-        //Write data to file
-        QTextDocumentWriter writer(file->fileName());
-        bool result = writer.write(ui->textEdit->document());
-        if(result)
-            main->updateMessage(" \U0001F5CE "+getName()+" saved!");
-        else {
-            QString text = ui->textEdit->toPlainText();
-            if(!file->open(QIODevice::WriteOnly)){
-                std::cerr << "ERROR: Failed to open file" << std::endl;
-                return;
-            }
-            file->write(text.toUtf8());
-            main->updateMessage(" \U0001F5CE "+getName()+" saved!");
-            std::cout << "INFO: Saved file as plain text" << std::endl;
+        //Write data to file. Pending autosaves go first, so they can't overwrite this one
+        main->waitForSaves();
+        if(!FileSaver::write(document(), file->fileName())){
+            std::cerr << "ERROR: Failed to save file" << std::endl;
+            return false;
         }
+        main->updateMessage(" \U0001F5CE "+getName()+" saved!");
+        encodingSaved();
     }
 
     file->close();
+    fileSynced(ChangeTracker::stateOf(document()));
+    journal->start(file->fileName());
+    return true;
+}
+
+//Text, HTML and Markdown are written as UTF-8, other formats are binary
+void ETab::encodingSaved(){
+    if(DocumentExporter::formatOf(QFileInfo(file->fileName()).suffix().toLatin1()) == DocumentExporter::UNKNOWN)
+        encoding.clear();
+    else
+        encoding = "UTF-8";
+    statsChanged();
+}
+
+//Editor and file are the same now
+void ETab::fileSynced(ChangeTracker::State state){
     //Set modified to false
-    ui->textEdit->document()->setModified(false);
+    document()->setModified(false);
+    tracker->synced(state);
+    pendingState = ChangeTracker::State(); //Older than this
+    QFileInfo info(file->fileName());
+    syncedSize = info.size();
+    syncedModified = info.lastModified();
 
-    //1000 kb max
-    if(((file->size() / 1024) < 1000) && !autosave){
+    //Any size, the scheduler adapts the delay to what saving costs
+    if(!autosave){
         setAutoSave(true);
         main->updateAutoSave(true);
     }
@@ -160,23 +398,573 @@ void ETab::useFile(bool write){
     changes = false;
 }
 
+//Hand a loaded file to the editor
+void ETab::setLoaded(LoadResult result){
+    pendingLoad = false;
+    progress->hide();
+    setPlaceholder(placeholder);
+    lockEditor(false);
+
+    if(!result.ok){
+        main->updateMessage("Failed to open "+getName());
+        return;
+    }
+
+    if(result.stream){
+        if(streamFile(QTextCodec::codecForName(result.encoding.toLatin1())))
+            return;
+
+        //Mapping failed, load it at once
+        result = FileLoader::read(result.fileName, false);
+        if(!result.ok)
+            return;
+    }
+
+    encoding = result.encoding;
+
+    //Images are placeholders before the editor lays the document out
+    if(!result.plain)
+        ImageLoader::load(result.document, ui->textEdit->devicePixelRatioF());
+    useDocument(result.document, result.plain);
+
+    fileSynced(result.state);
+    markdown = result.markdown;
+    markdown.revision = document()->revision();
+    replayJournal();
+    selectPending();
+}
+
+//Document was built elsewhere, the editor owns it from now on. Documents the editors
+//made themselves are deleted by setDocument, so old is not used after it unless it is ours
+void ETab::useDocument(QTextDocument *doc, bool plain){
+    QTextDocument *old = document();
+    QAbstractScrollArea *oldEditor = editor();
+    bool ownsOld = old->parent() == oldEditor;
+    usePlainEditor(plain);
+
+    //The editor that isn't used anymore gets an empty document, so the old one can go
+    if(ownsOld && editor() != oldEditor){
+        QTextDocument *empty = new QTextDocument(oldEditor);
+        connect(empty, &QTextDocument::contentsChange, this, &ETab::contentsChange);
+        if(oldEditor == plainEdit){
+            empty->setDocumentLayout(new QPlainTextDocumentLayout(empty));
+            plainEdit->setDocument(empty);
+        } else
+            ui->textEdit->setDocument(empty);
+    }
+
+    doc->setParent(editor());
+    doc->setDefaultFont(ui->textEdit->font());
+    if(plainText){
+        //Must be set before the editor asks the document for its layout
+        doc->setDocumentLayout(new QPlainTextDocumentLayout(doc));
+        plainEdit->setDocument(doc);
+    } else
+        ui->textEdit->setDocument(doc);
+    connect(doc, &QTextDocument::contentsChange, this, &ETab::contentsChange);
+    stats->setDocument(doc);
+    headings->setDocument(plainText ? nullptr : doc);
+    updateFind(); //Highlights belong to the old document
+    if(ownsOld)
+        old->deleteLater();
+}
+
+//The file changed on disk. Tabs without unsaved edits show the new content. Markdown
+//re-parses only the chunks that changed, as long as the document was not edited since
+void ETab::fileChanged(FileLoader *loader){
+    if(stub || isLoading() || viewer != nullptr || !file->exists())
+        return;
+
+    //Own save
+    QFileInfo info(file->fileName());
+    if(info.size() == syncedSize && info.lastModified() == syncedModified)
+        return;
+
+    //Own save in background, it is written over anyway
+    if(pendingState.revision >= 0)
+        return;
+
+    if(changes || journal->hasEntries() || tracker->isDirty(document())){
+        main->updateMessage(getName()+" changed on disk, keeping the unsaved changes");
+        return;
+    }
+
+    QFile f(file->fileName());
+    if(markdown.revision == document()->revision() && f.open(QIODevice::ReadOnly)){
+        QByteArray data = f.readAll();
+        f.close();
+
+        //One edit block, so images of the new chunks are placeholders before the layout
+        journal->stop();
+        QTextCursor block(document());
+        block.beginEditBlock();
+        bool updated = MarkdownImporter::update(document(), &markdown, TextDecoder::decode(data).text);
+        if(updated)
+            ImageLoader::load(document(), ui->textEdit->devicePixelRatioF());
+        block.endEditBlock();
+
+        if(updated){
+            fileSynced(ChangeTracker::stateOf(document()));
+            markdown.revision = document()->revision();
+            journal->start(file->fileName());
+            main->updateMessage(" \U0001F5CE "+getName()+" reloaded");
+            return;
+        }
+    }
+
+    openFile(loader);
+}
+
+//Restore edits that were not written to the file before a crash
+void ETab::replayJournal(){
+    if(journal->replay(file->fileName(), document())){
+        changes = true;
+        main->updateMessage("Restored unsaved changes of "+getName());
+    } else
+        journal->start(file->fileName());
+}
+
+//Start streaming the file into the editor
+bool ETab::streamFile(QTextCodec *codec){
+    journal->stop();
+    usePlainEditor(true);
+    stats->setDocument(nullptr); //Counted once it is loaded
+    headings->setDocument(nullptr);
+    plainEdit->clear();
+    if(codec == nullptr || !streamer->start(file->fileName(), document(), codec))
+        return false;
+
+    encoding = codec->name();
+
+    progress->setRange(0, 100);
+    progress->setValue(0);
+    progress->show();
+    lockEditor(true);
+    return true;
+}
+
+//Make editor read only while a file is loading
+void ETab::lockEditor(bool lock){
+    if(lock == locked)
+        return;
+
+    if(plainText){
+        if(lock){
+            interactionFlags = plainEdit->textInteractionFlags();
+            plainEdit->setReadOnly(true);
+        } else
+            plainEdit->setTextInteractionFlags(interactionFlags);
+    } else if(lock){
+        interactionFlags = ui->textEdit->textInteractionFlags();
+        ui->textEdit->setReadOnly(true);
+    } else
+        ui->textEdit->setTextInteractionFlags(interactionFlags);
+
+    locked = lock;
+}
+
+//Write the edits to the journal. Once it is big, rewrite the file in background.
+//Called by the autosave scheduler. Returns bytes written, or -1 to try again later
+qint64 ETab::autoSave(){
+    if(stub || viewer != nullptr)
+        return 0;
+
+    //Quick note: keep a copy in the recovery store. It still counts as unsaved
+    if(!file->exists()){
+        if(notePath.isEmpty() || !noteDirty)
+            return 0;
+
+        QTextDocument *snapshot = document()->clone();
+        qint64 bytes = snapshot->characterCount();
+        main->saveInBackground(snapshot, notePath);
+        noteDirty = false;
+        return bytes;
+    }
+
+    if(!autosave || !changes)
+        return 0;
+
+    if(isLoading())
+        return -1;
+
+    if(journal->size() < JOURNAL_LIMIT){
+        qint64 bytes = journal->pendingSize();
+        if(!journal->flush())
+            return -1;
+
+        changes = false;
+        return bytes;
+    }
+
+    //Same content as the file, e.g. after typing and undoing: the journal is all there is to drop
+    if(pendingState.revision < 0 && !tracker->needsWrite(document())){
+        journal->start(file->fileName());
+        changes = false;
+        return 0;
+    }
+
+    //Copying the document is cheap compared to serializing and writing it
+    journal->beginCompaction();
+    pendingState = ChangeTracker::stateOf(document());
+    QTextDocument *snapshot = document()->clone();
+    qint64 bytes = snapshot->characterCount();
+    main->saveInBackground(snapshot, file->fileName());
+
+    document()->setModified(false);
+    changes = false;
+    return bytes;
+}
+
+//Background save of this file is done
+void ETab::backgroundSaved(bool ok){
+    if(!fileExists()){
+        //Recovery copy of a quick note
+        if(!ok)
+            noteDirty = true;
+        return;
+    }
+
+    journal->endCompaction(ok);
+
+    //File has the snapshot now, unless a save of a newer state came first
+    if(ok && pendingState.revision >= 0){
+        tracker->synced(pendingState);
+        QFileInfo info(file->fileName());
+        syncedSize = info.size();
+        syncedModified = info.lastModified();
+        encodingSaved();
+    }
+    pendingState = ChangeTracker::State();
+
+    //Save again later
+    if(!ok){
+        document()->setModified(true);
+        markChanged();
+    }
+}
+
+//Remember there is something to save and queue it
+void ETab::markChanged(){
+    changes = true;
+    if(autosave)
+        main->scheduleAutoSave(this);
+}
+
+//Record edits for the journal
+void ETab::contentsChange(int position, int removed, int added){
+    journal->record(document(), position, removed, added);
+
+    //Blocks the highlighting was at may be gone, start over once typing pauses
+    if(!findBar->isHidden()){
+        finder->cancel();
+        findTimer->start();
+    }
+}
+
+/*
+ * Find and replace
+ */
+
+//Show find bar, with the selection as pattern
+void ETab::showFind(bool replace){
+    QString selected = getSelection();
+    //Matches don't span lines
+    if(selected.contains(QChar::ParagraphSeparator))
+        selected.clear();
+
+    findBar->open(replace && viewer == nullptr, selected);
+    updateFind();
+}
+
+void ETab::closeFind(){
+    findBar->hide();
+    updateFind();
+    focus();
+}
+
+void ETab::findChanged(){
+    finder->setPattern(findBar->pattern(), findBar->isRegex(), findBar->isCaseSensitive());
+    updateFind();
+}
+
+//Highlight matches again, visible ones first
+void ETab::updateFind(){
+    findTimer->stop();
+    finder->cancel();
+    highlights.clear();
+    showHighlights();
+
+    if(findBar->isHidden())
+        return;
+
+    if(finder->isEmpty()){
+        QString error = finder->errorString();
+        findBar->setStatus(error, !error.isEmpty());
+        return;
+    }
+
+    //The viewer only shows the match that was found
+    if(viewer != nullptr){
+        findBar->setStatus(QString());
+        return;
+    }
+
+    QWidget *viewport = editor()->viewport();
+    QPoint end(viewport->width() - 1, viewport->height() - 1);
+    int first, last;
+    if(plainText){
+        first = plainEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+        last = plainEdit->cursorForPosition(end).blockNumber();
+    } else {
+        first = ui->textEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+        last = ui->textEdit->cursorForPosition(end).blockNumber();
+    }
+    finder->highlight(document(), first, last);
+}
+
+void ETab::showHighlights(){
+    if(plainText)
+        plainEdit->setExtraSelections(highlights);
+    else
+        ui->textEdit->setExtraSelections(highlights);
+}
+
+void ETab::matchesFound(QVector<FindEngine::Match> matches){
+    QTextDocument *doc = document();
+    for(const FindEngine::Match &m : matches){
+        if(highlights.size() >= MAX_HIGHLIGHTS)
+            break;
+
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(doc);
+        selection.cursor.setPosition(m.position);
+        selection.cursor.setPosition(m.position + m.length, QTextCursor::KeepAnchor);
+        selection.format.setBackground(QColor(255, 210, 0, 140));
+        highlights.append(selection);
+    }
+
+    //Visible matches come at once and are shown at once. Handing the growing list to the
+    //editor for every batch of the rest would copy it again and again, it is shown when done
+    if(!finder->isRunning())
+        showHighlights();
+    findBar->setStatus(QString("%1 matches...").arg(finder->count()));
+}
+
+void ETab::matchesFinished(int count){
+    showHighlights();
+    findBar->setStatus(count == 1 ? QString("1 match") : QString("%1 matches").arg(count));
+}
+
+//Select next (or previous) match after the cursor
+void ETab::findNext(bool backward){
+    if(findBar->isHidden() || finder->isEmpty())
+        return;
+
+    if(viewer != nullptr){
+        viewer->find(findBar->pattern(), findBar->isRegex(), findBar->isCaseSensitive(), backward);
+        return;
+    }
+
+    QTextCursor cursor = textCursor();
+    int from = backward ? cursor.selectionStart() : cursor.selectionEnd();
+    QTextCursor match = finder->find(document(), from, backward);
+    if(match.isNull()){
+        findBar->setStatus("No matches");
+        return;
+    }
+
+    setTextCursor(match);
+}
+
+//Replace the selected match and go to the next one
+void ETab::replace(){
+    if(viewer != nullptr || locked || finder->isEmpty())
+        return;
+
+    QTextCursor cursor = textCursor();
+    if(cursor.hasSelection()){
+        FindEngine::Match hit;
+        QTextCursor match = finder->find(document(), cursor.selectionStart(), false, &hit);
+        if(match.selectionStart() == cursor.selectionStart() && match.selectionEnd() == cursor.selectionEnd())
+            cursor.insertText(finder->replacementFor(hit, findBar->replacement()));
+    }
+
+    findNext();
+}
+
+//Replace every match, undone at once
+void ETab::replaceAll(){
+    if(viewer != nullptr || locked || finder->isEmpty())
+        return;
+
+    int count = finder->replaceAll(document(), findBar->replacement());
+    main->updateMessage(QString("Replaced %1 matches").arg(count));
+}
+
+//What find in files searches: the text of the editor, or the file or saved note of a restored tab
+FileSearch::Source ETab::searchSource(){
+    FileSearch::Source source;
+    source.id = objectName();
+    source.title = getName();
+    source.path = fileExists() ? getFileName() : notePath;
+
+    if(viewer != nullptr){
+        //Read from the file
+    } else if(!stub){
+        source.text = document()->toPlainText();
+        source.hasText = true;
+    } else if(!fileExists()){
+        //Quick note, content of old sessions is not in the recovery store yet
+        source.html = true;
+        source.text = stubContent;
+        source.hasText = !stubContent.isEmpty();
+    }
+
+    return source;
+}
+
+//Select a find in files result. Positions only fit the text of open tabs, else the line is used.
+//A tab that is loading selects it once it is done
+void ETab::select(SearchHit hit){
+    if(viewer != nullptr){
+        viewer->select(hit.line, hit.column, hit.length);
+        return;
+    }
+
+    if(stub || isLoading()){
+        pendingHit = hit;
+        hitPending = true;
+        return;
+    }
+
+    QTextDocument *doc = document();
+    int position = hit.position;
+    if(position < 0){
+        QTextBlock block = doc->findBlockByNumber(hit.line);
+        if(!block.isValid())
+            return;
+        position = block.position() + qMin(hit.column, block.length() - 1);
+    }
+
+    int last = doc->characterCount() - 1;
+    QTextCursor cursor(doc);
+    cursor.setPosition(qMin(position, last));
+    cursor.setPosition(qMin(position + hit.length, last), QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+}
+
+void ETab::gotoLine(int line){
+    if(viewer != nullptr){
+        viewer->gotoLine(line);
+        return;
+    }
+
+    QTextBlock block = document()->findBlockByNumber(line);
+    if(block.isValid())
+        setTextCursor(QTextCursor(block));
+}
+
+int ETab::lineCount() {
+    return viewer != nullptr ? viewer->lineCount() : document()->blockCount();
+}
+
+OutlineIndex *ETab::outline() {
+    return headings;
+}
+
+//Go to a heading of the outline, showing it if its section is collapsed
+void ETab::gotoHeading(int index){
+    if(viewer != nullptr || isLoading())
+        return;
+
+    headings->expandTo(index);
+    QTextBlock block = headings->block(index);
+    if(!block.isValid())
+        return;
+
+    setTextCursor(QTextCursor(block));
+    focus();
+}
+
+void ETab::selectPending(){
+    if(!hitPending)
+        return;
+
+    hitPending = false;
+    select(pendingHit);
+}
+
 void ETab::openFile() { this->useFile(false);}
-void ETab::saveFile(bool force) {
-    if(changes || force)
-        this->useFile(true);
+
+//Open file in background, the tab is a placeholder until it is done
+void ETab::openFile(FileLoader *loader) {
+    journal->stop();
+    pendingLoad = true;
+    lockEditor(true);
+    setPlaceholder("Loading...");
+    progress->setRange(0, 0);
+    progress->show();
+    loader->load(this);
+}
+
+//Returns false if the file needed writing and it failed
+bool ETab::saveFile(bool force) {
+    //The viewer is read only
+    if(viewer != nullptr)
+        return false;
+
+    //Journaled edits are merged into the file on save and close
+    if(!changes && !force && !journal->hasEntries())
+        return true;
+
+    //Same content as the file, e.g. after typing and undoing: nothing to write.
+    //Not while a background save is running, the file is about to change
+    if(!force && !stub && !isLoading() && pendingState.revision < 0 && file->exists() && !tracker->needsWrite(document())){
+        journal->start(file->fileName());
+        changes = false;
+        return true;
+    }
+
+    return this->useFile(true);
 }
 
 //Getter/setter
 QString ETab::getFileName() { return file->fileName(); }
 void ETab::setFileName(QString name){ file = new QFile(name); }
 
+//Recovery file of a quick note, empty for tabs that are no quick note
+QString ETab::getNotePath() { return notePath; }
+void ETab::setNotePath(QString path) { notePath = path; }
+
+//Write quick note to the recovery store now, if it changed since the last autosave
+void ETab::saveNote(){
+    if(notePath.isEmpty())
+        return;
+
+    if(stub){
+        if(!stubContent.isEmpty())
+            NoteStore::write(notePath, stubContent);
+        return;
+    }
+
+    if(!noteDirty)
+        return;
+
+    main->waitForSaves();
+    if(FileSaver::write(document(), notePath))
+        noteDirty = false;
+}
+
 QString ETab::getName(){
     QFileInfo i(getFileName());
     return i.fileName();
 }
 
 bool ETab::hasChanges() {
-    if(ui->textEdit->toPlainText().length() == 0 || dontSave)
+    if(stub)
+        return !dontSave && (!stubContent.isEmpty() || !notePath.isEmpty());
+
+    if(ChangeTracker::isEmpty(document()) || dontSave)
         return false;
 
     return changes;
@@ -186,9 +974,23 @@ bool ETab::isAutosave() {
     return autosave;
 }
 
+//Average GUI time (ms) of an autosave of this tab, -1 if unknown
+double ETab::getSaveCost() { return saveCost; }
+void ETab::setSaveCost(double msec) { saveCost = msec; }
+
+qint64 ETab::documentSize() {
+    if(stub)
+        return stubContent.size();
+
+    return document()->characterCount();
+}
+
 //Increase/decrease fontsize
 void ETab::changeFontSize(bool increase){
-    QTextCursor cursor = ui->textEdit->textCursor();
+    if(plainText)
+        return;
+
+    QTextCursor cursor = textCursor();
     QTextCharFormat fmt;
     QFont font = cursor.charFormat().font();
 
@@ -204,8 +1006,11 @@ void ETab::changeFontSize(bool increase){
 
 //Change font format
 void ETab::changeFont() {
+    if(plainText)
+        return;
+
     bool ok;
-    QFont font = QFontDialog::getFont(&ok, ui->textEdit->textCursor().charFormat().font(), this);
+    QFont font = QFontDialog::getFont(&ok, textCursor().charFormat().font(), this);
     if(ok){
         QTextCharFormat format;
         format.setFont(font);
@@ -221,13 +1026,21 @@ void ETab::changeColor(){
 
 //Merge font format into current cursor
 void ETab::mergeFormat(QTextCharFormat format){
-    QTextCursor cursor = ui->textEdit->textCursor();
+    if(plainText)
+        return;
+
+    QTextCursor cursor = textCursor();
     cursor.mergeCharFormat(format);
     ui->textEdit->mergeCurrentCharFormat(format);
 }
 
 void ETab::insertLink(QString text, QString url) {
-    QTextCursor cursor = ui->textEdit->textCursor();
+    QTextCursor cursor = textCursor();
+    if(plainText){
+        cursor.insertText(url);
+        return;
+    }
+
     cursor.insertHtml("<a href=\""+url+"\">"+text+"</a>&nbsp;");
 }
 
@@ -237,7 +1050,10 @@ void ETab::createLink() {
 }
 
 QString ETab::getSelection() {
-    QTextCursor cursor = ui->textEdit->textCursor();
+    if(viewer != nullptr)
+        return viewer->selectedText();
+
+    QTextCursor cursor = textCursor();
     if(cursor.hasSelection())
         return cursor.selectedText();
     else
@@ -245,16 +1061,19 @@ QString ETab::getSelection() {
 }
 
 QColor ETab::foreground() {
-    return ui->textEdit->textCursor().charFormat().foreground().color();
+    return textCursor().charFormat().foreground().color();
 }
 
 QColor ETab::background() {
-    return ui->textEdit->textCursor().charFormat().background().color();
+    return textCursor().charFormat().background().color();
 }
 
 //Set special style like header or list
 void ETab::setStyle(int type){
-    QTextCursor cursor = ui->textEdit->textCursor();
+    if(plainText)
+        return;
+
+    QTextCursor cursor = textCursor();
     QTextListFormat::Style style = QTextListFormat::ListStyleUndefined;
     QTextBlockFormat::MarkerType marker = QTextBlockFormat::MarkerType::NoMarker;
 
@@ -343,6 +1162,9 @@ void ETab::setStyle(int type){
 }
 
 void ETab::setAlign(int type){
+    if(plainText)
+        return;
+
     switch (type) {
         case 0:
         ui->textEdit->setAlignment(Qt::AlignLeft | Qt::AlignAbsolute);
@@ -362,3 +1184,7 @@ void ETab::setAlign(int type){
 bool ETab::fileExists() {
     return file->exists();
 }
+
+bool ETab::isLoading() {
+    return pendingLoad || streamer->isRunning();
+}
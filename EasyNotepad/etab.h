@@ -2,12 +2,26 @@
 #define ETAB_H
 
 #include <QWidget>
-#include <QTimer>
 #include <QFile>
 #include <QTextListFormat>
 #include <QTextCharFormat>
 #include <QColor>
+#include <QProgressBar>
+#include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QTimer>
+#include <QDateTime>
 #include <mainwindow.h>
+#include <filestreamer.h>
+#include <fileloader.h>
+#include <editjournal.h>
+#include <changetracker.h>
+#include <findengine.h>
+#include <findbar.h>
+#include <filesearch.h>
+#include <largefileview.h>
+#include <documentstats.h>
+#include <outlineindex.h>
 
 namespace Ui {
 class ETab;
@@ -24,12 +38,28 @@ public:
     QString getFileName();
     bool hasChanges();
     bool isAutosave();
+    double getSaveCost();
+    void setSaveCost(double msec);
+    qint64 documentSize();
     void setFileName(QString name);
+    QString getNotePath();
+    void setNotePath(QString path);
+    void saveNote();
     void changeFontSize(bool increase);
     void changeFont();
     void changeColor();
     void openFile();
-    void saveFile(bool force = false);
+    void openFile(FileLoader *loader);
+    void setLoaded(LoadResult result);
+    void setStub(QString content);
+    bool isStub();
+    void materialize(FileLoader *loader);
+    bool viewFile();
+    bool isViewer();
+    bool saveFile(bool force = false);
+    void backgroundSaved(bool ok);
+    void markChanged();
+    qint64 autoSave();
     void setAutoSave(bool enabled);
     void setStyle(int type);
     void setAlign(int type);
@@ -41,24 +71,90 @@ public:
     QString getSelection();
     QString getContent();
     bool fileExists();
+    bool isLoading();
+    QTextDocument *document(); //Of the editor in use
     QColor foreground();
     QColor background();
+    void showFind(bool replace);
+    void findNext(bool backward = false);
+    void replace();
+    void replaceAll();
+    FileSearch::Source searchSource();
+    void select(SearchHit hit);
+    void gotoLine(int line);
+    int lineCount();
+    QString statistics();
+    void fileChanged(FileLoader *loader);
+    OutlineIndex *outline();
+    void gotoHeading(int index);
 
 private slots:
-    void timerTick();
     void on_textEdit_currentCharFormatChanged(const QTextCharFormat &format);
     void on_textEdit_cursorPositionChanged();
     void on_textEdit_textChanged();
+    void streamProgress(int percent);
+    void streamFinished(bool ok);
+    void contentsChange(int position, int removed, int added);
+    void findChanged();
+    void matchesFound(QVector<FindEngine::Match> matches);
+    void matchesFinished(int count);
+    void closeFind();
+    void viewerFound(bool ok);
+    void viewerIndexed(int lines);
+    void viewerScrolled(int line);
+    void statsChanged();
 
 private:
     Ui::ETab *ui;
     MainWindow *main;
     QFile *file;
-    QTimer *timer;
+    FileStreamer *streamer;
+    LargeFileView *viewer;
+    QPlainTextEdit *plainEdit; //Editor of plain text files, created when one is loaded
+    bool plainText;
+    EditJournal *journal;
+    ChangeTracker *tracker;
+    DocumentStats *stats;
+    OutlineIndex *headings;
+    ChangeTracker::State pendingState;
+    qint64 syncedSize; //Of the file when it was last read or written, to tell own saves apart
+    QDateTime syncedModified;
+    MarkdownImporter::Index markdown;
+    QString encoding; //Of the file as read, empty if unknown
+    QProgressBar *progress;
+    FindEngine *finder;
+    FindBar *findBar;
+    QTimer *findTimer;
+    QList<QTextEdit::ExtraSelection> highlights;
+    SearchHit pendingHit;
+    bool hitPending;
+    Qt::TextInteractionFlags interactionFlags;
+    QString placeholder;
+    bool pendingLoad;
+    bool locked;
+    bool stub;
+    QString stubContent;
+    QString notePath;
+    bool noteDirty;
+    double saveCost;
     bool autosave;
     bool changes;
     bool dontSave;
-    void useFile(bool write);
+    bool useFile(bool write);
+    void encodingSaved();
+    bool streamFile(QTextCodec *codec);
+    void useDocument(QTextDocument *doc, bool plain);
+    void fileSynced(ChangeTracker::State state);
+    void replayJournal();
+    void lockEditor(bool lock);
+    void usePlainEditor(bool plain);
+    QAbstractScrollArea *editor();
+    QTextCursor textCursor();
+    void setTextCursor(const QTextCursor &cursor);
+    void setPlaceholder(QString text);
+    void showHighlights();
+    void updateFind();
+    void selectPending();
     QString getName();
 };
 
@@ -0,0 +1,63 @@
+#include "fileclassifier.h"
+
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTextDocument>
+
+#include <filestreamer.h>
+#include <largefileview.h>
+#include <nativeformat.h>
+#include <textdecoder.h>
+
+//Bytes of the file that are looked at
+#define PROBE_SIZE (64 * 1024)
+
+QMutex FileClassifier::mutex;
+QHash<QString, FileClassifier::Entry> FileClassifier::cache;
+
+//One database for all lookups, it is safe to use from any thread
+QMimeDatabase &FileClassifier::mimeDatabase(){
+    static QMimeDatabase db;
+    return db;
+}
+
+FileClassifier::Result FileClassifier::classify(QString fileName){
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return Result();
+    return classify(&file);
+}
+
+//Classify an open file. Reads the head without moving the position
+FileClassifier::Result FileClassifier::classify(QFile *file){
+    QFileInfo info(*file);
+    QString path = info.canonicalFilePath();
+    qint64 size = info.size();
+    QDateTime modified = info.lastModified();
+
+    {
+        QMutexLocker lock(&mutex);
+        auto it = cache.constFind(path);
+        if(it != cache.constEnd() && it->size == size && it->modified == modified)
+            return it->result;
+    }
+
+    QByteArray head = file->peek(PROBE_SIZE);
+    Result result;
+    result.view = LargeFileView::shouldView(size);
+    if(NativeFormat::isNative(head))
+        result.type = NATIVE;
+    else if(Qt::mightBeRichText(TextDecoder::decode(head, true).text))
+        result.type = HTML;
+    else if(mimeDatabase().mimeTypeForFileNameAndData(file->fileName(), head).name() == QLatin1String("text/markdown"))
+        result.type = MARKDOWN;
+    else
+        result.type = PLAIN;
+    result.stream = result.type == PLAIN && FileStreamer::shouldStream(size);
+
+    if(!path.isEmpty()){
+        QMutexLocker lock(&mutex);
+        cache.insert(path, {result, size, modified});
+    }
+    return result;
+}
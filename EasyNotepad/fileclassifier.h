@@ -0,0 +1,39 @@
+#ifndef FILECLASSIFIER_H
+#define FILECLASSIFIER_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QMimeDatabase>
+#include <QMutex>
+#include <QString>
+
+//Decides how a file is opened from its size, its name and the first bytes only.
+//Results are kept per file until its size or modification time change
+class FileClassifier
+{
+public:
+    enum Type { PLAIN, HTML, MARKDOWN, NATIVE };
+
+    struct Result {
+        Type type = PLAIN;
+        bool view = false; //Too big to edit, shown in the read only viewer
+        bool stream = false; //Big plain text, streamed into the editor
+    };
+
+    static Result classify(QString fileName);
+    static Result classify(QFile *file);
+    static QMimeDatabase &mimeDatabase();
+
+private:
+    struct Entry {
+        Result result;
+        qint64 size;
+        QDateTime modified;
+    };
+
+    static QMutex mutex;
+    static QHash<QString, Entry> cache;
+};
+
+#endif // FILECLASSIFIER_H
@@ -0,0 +1,129 @@
+#include "fileloader.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QPointer>
+#include <QThread>
+#include <QUrl>
+#include <iostream>
+
+#include <etab.h>
+#include <fileclassifier.h>
+#include <nativeformat.h>
+#include <textdecoder.h>
+
+//Bytes the encoding of streamed files is detected from
+#define HEAD_SIZE (64 * 1024)
+
+FileLoader::FileLoader(QObject *parent) : QObject(parent)
+{
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+FileLoader::~FileLoader()
+{
+    //Don't let workers outlive the loader
+    pool->clear();
+    pool->waitForDone();
+
+    //Results that are still queued are dropped with the loader
+    qDeleteAll(queued);
+}
+
+//Load file of tab in background. The tab gets the result through ETab::setLoaded
+void FileLoader::load(ETab *tab){
+    QPointer<ETab> target(tab);
+    QString fileName = tab->getFileName();
+    QThread *gui = QCoreApplication::instance()->thread();
+
+    pool->start([this, target, fileName, gui]() {
+        LoadResult result = FileLoader::read(fileName);
+        if(result.document != nullptr){
+            result.document->moveToThread(gui);
+            QMutexLocker lock(&mutex);
+            queued.insert(result.document);
+        }
+
+        QMetaObject::invokeMethod(this, [this, target, result]() {
+            {
+                QMutexLocker lock(&mutex);
+                queued.remove(result.document);
+            }
+            if(target.isNull()){
+                delete result.document; //Tab was closed in the meantime
+                return;
+            }
+            target->setLoaded(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+//Directory of the file, images and links in it are relative to this
+static QUrl baseUrlOf(QString fileName){
+    return (fileName.front() == QLatin1Char(':') ? QUrl(fileName) : QUrl::fromLocalFile(fileName)).adjusted(QUrl::RemoveFilename);
+}
+
+//Read and parse a file on the calling thread
+LoadResult FileLoader::read(QString fileName, bool allowStream){
+    LoadResult result;
+    result.fileName = fileName;
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        std::cerr << "ERROR: Failed to read file" << std::endl;
+        return result;
+    }
+
+    result.size = file.size();
+    FileClassifier::Result type = FileClassifier::classify(&file);
+
+    //Native documents are built from the mapped file, without parsing
+    if(type.type == FileClassifier::NATIVE){
+        QTextDocument *doc = new QTextDocument();
+        doc->setBaseUrl(baseUrlOf(fileName));
+        if(!NativeFormat::read(&file, doc)){
+            std::cerr << "ERROR: Failed to read document" << std::endl;
+            delete doc;
+            return result;
+        }
+
+        result.document = doc;
+        result.state = ChangeTracker::stateOf(doc);
+        result.ok = true;
+        return result;
+    }
+
+    //Big plain text files are streamed by the tab, in the encoding of their head
+    if(allowStream && type.stream){
+        result.encoding = TextDecoder::codecFor(file.peek(HEAD_SIZE))->name();
+        result.ok = true;
+        result.stream = true;
+        result.plain = true;
+        return result;
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    //Decoded once, for rich and plain text alike
+    TextDecoder::Result decoded = TextDecoder::decode(data);
+    const QString &str = decoded.text;
+    result.encoding = decoded.encoding;
+
+    QTextDocument *doc = new QTextDocument();
+    doc->setBaseUrl(baseUrlOf(fileName));
+    if(type.type == FileClassifier::HTML)
+        doc->setHtml(str);
+    else if(type.type == FileClassifier::MARKDOWN)
+        MarkdownImporter::import(doc, str, &result.markdown);
+    else {
+        doc->setPlainText(str);
+        result.plain = true;
+    }
+
+    result.document = doc;
+    result.state = ChangeTracker::stateOf(doc);
+    result.ok = true;
+    return result;
+}
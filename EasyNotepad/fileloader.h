@@ -0,0 +1,46 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QMutex>
+#include <QSet>
+#include <QTextDocument>
+#include <changetracker.h>
+#include <markdownimporter.h>
+
+class ETab;
+
+//Result of reading a file. The document is owned by whoever receives it
+struct LoadResult {
+    QString fileName;
+    bool ok = false;
+    bool stream = false; //Big plain text file, to be streamed in by the tab
+    bool plain = false; //No rich text, edited without rich text layout
+    qint64 size = 0;
+    QString encoding; //Detected when decoding, for the status bar
+    QTextDocument *document = nullptr;
+    ChangeTracker::State state; //Of the document as read, hashed on the worker
+    MarkdownImporter::Index markdown; //Chunks of a Markdown file, to re-parse only changed ones
+};
+
+//Reads, decodes and parses files on a worker pool.
+//Only handing the document to the tab happens on the GUI thread
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(QObject *parent = nullptr);
+    ~FileLoader();
+    void load(ETab *tab);
+    static LoadResult read(QString fileName, bool allowStream = true);
+
+private:
+    QThreadPool *pool;
+    QMutex mutex;
+    QSet<QTextDocument*> queued; //Read, not handed to the tab yet
+};
+
+#endif // FILELOADER_H
@@ -0,0 +1,95 @@
+#include "filesaver.h"
+
+#include <QSaveFile>
+#include <QTextDocumentWriter>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <iostream>
+
+#include <documentexporter.h>
+#include <nativeformat.h>
+#include <notestore.h>
+
+FileSaver::FileSaver(QObject *parent) : QObject(parent)
+{
+    thread = new QThread(this);
+    worker = new QObject();
+    worker->moveToThread(thread);
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    thread->start();
+}
+
+FileSaver::~FileSaver()
+{
+    //Finish pending saves before quitting
+    flush();
+    thread->quit();
+    thread->wait();
+}
+
+//Write snapshot in background. Takes ownership of the snapshot
+void FileSaver::save(QTextDocument *snapshot, QString fileName){
+    snapshot->moveToThread(thread);
+
+    QMetaObject::invokeMethod(worker, [this, snapshot, fileName]() {
+        QElapsedTimer elapsed;
+        elapsed.start();
+        bool ok = FileSaver::write(snapshot, fileName);
+        delete snapshot;
+        emit saved(fileName, ok, elapsed.elapsed());
+    }, Qt::QueuedConnection);
+}
+
+//Delete file after the saves queued before, so none of them can bring it back
+void FileSaver::remove(QString fileName){
+    QMetaObject::invokeMethod(worker, [fileName]() {
+        QFile::remove(fileName);
+    }, Qt::QueuedConnection);
+}
+
+//Block until all queued saves are written
+void FileSaver::flush(){
+    QMetaObject::invokeMethod(worker, []() {}, Qt::BlockingQueuedConnection);
+}
+
+//Write document to file. The file is replaced at once, so a crash can't leave half a file
+bool FileSaver::write(QTextDocument *document, QString fileName){
+    //Quick notes go to the blobs of the note store
+    if(NoteStore::isNote(fileName))
+        return NoteStore::write(fileName, document->toHtml("UTF-8"));
+
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        std::cerr << "ERROR: Failed to open file" << std::endl;
+        return false;
+    }
+
+    //Format by suffix, like QTextDocumentWriter(fileName) does. Text, HTML and Markdown
+    //are written part by part, the rest (ODF) at once by QTextDocumentWriter
+    QByteArray format = QFileInfo(fileName).suffix().toLower().toLatin1();
+    DocumentExporter::Format streamed = DocumentExporter::formatOf(format);
+    bool result;
+    if(format == NativeFormat::SUFFIX)
+        result = NativeFormat::write(document, &file);
+    else if(streamed != DocumentExporter::UNKNOWN)
+        result = DocumentExporter::write(document, &file, streamed);
+    else {
+        QTextDocumentWriter writer(&file, format);
+        result = writer.write(document);
+
+        //Unknown format: nothing is written yet, so save as plain text
+        if(!result && file.pos() == 0){
+            result = DocumentExporter::write(document, &file, DocumentExporter::PLAINTEXT);
+            std::cout << "INFO: Saved file as plain text" << std::endl;
+        }
+    }
+
+    if(!result){
+        std::cerr << "ERROR: Failed to write file" << std::endl;
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
@@ -0,0 +1,30 @@
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTextDocument>
+
+//Writes document snapshots on a background thread.
+//Saves run one after another, so an older snapshot never overwrites a newer one
+class FileSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileSaver(QObject *parent = nullptr);
+    ~FileSaver();
+    void save(QTextDocument *snapshot, QString fileName);
+    void remove(QString fileName);
+    void flush();
+    static bool write(QTextDocument *document, QString fileName);
+
+signals:
+    void saved(QString fileName, bool ok, qint64 msec);
+
+private:
+    QThread *thread;
+    QObject *worker;
+};
+
+#endif // FILESAVER_H
@@ -0,0 +1,342 @@
+#include "filesearch.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QScopedPointer>
+#include <QTextCodec>
+#include <QThread>
+
+#include <findengine.h>
+#include <notestore.h>
+#include <textdecoder.h>
+
+//Hits reported per file at most
+static const int MAX_FILE_HITS = 1000;
+//Characters of the line shown around a hit
+static const int PREVIEW_BEFORE = 60;
+static const int PREVIEW_LENGTH = 200;
+//Bytes at the start of a file that are checked for zero bytes, which means it is binary
+static const qint64 BINARY_PROBE = 8 * 1024;
+//Bigger files in directories are skipped
+static const qint64 MAX_FILE_SIZE = 512 * 1024 * 1024;
+//Files are decoded and searched this many bytes at a time, so a worker holds a few MB at most
+static const int CHUNK_SIZE = 4 * 1024 * 1024;
+//Bytes at the start of a file its encoding is detected from
+static const int HEAD_SIZE = 64 * 1024;
+//Characters a regex match may span across chunks, and the text before a chunk it may look at
+static const int REGEX_OVERLAP = 4096;
+
+FileSearch::FileSearch(QObject *parent) : QObject(parent)
+{
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(QThread::idealThreadCount());
+}
+
+FileSearch::~FileSearch()
+{
+    //Don't let workers outlive the search
+    cancel();
+    pool->clear();
+    pool->waitForDone();
+}
+
+//Search the sources and, if given, all files below directory
+void FileSearch::start(QString pattern, bool regex, bool caseSensitive, QList<Source> sources, QString directory){
+    cancel();
+
+    QSharedPointer<State> state(new State());
+    state->query.pattern = pattern;
+    state->query.regex = regex;
+    state->query.caseSensitive = caseSensitive;
+
+    if(pattern.isEmpty() || (regex && !QRegularExpression(pattern).isValid())){
+        emit finished(0, 0);
+        return;
+    }
+
+    for(const Source &source : sources) {
+        if(!source.path.isEmpty())
+            state->skip.insert(QFileInfo(source.path).canonicalFilePath());
+    }
+
+    bool withDirectory = !directory.isEmpty() && QFileInfo(directory).isDir();
+    state->outstanding.storeRelease(sources.size() + (withDirectory ? 1 : 0));
+    current = state;
+
+    if(state->outstanding.loadAcquire() == 0){
+        current.clear();
+        emit finished(0, 0);
+        return;
+    }
+
+    for(const Source &source : sources) {
+        pool->start([this, state, source]() { searchSource(state, source); });
+    }
+
+    if(withDirectory)
+        pool->start([this, state, directory]() { searchDirectory(state, directory); });
+}
+
+//Stop the running search. Tasks that are queued return at once
+void FileSearch::cancel(){
+    if(current.isNull())
+        return;
+
+    current->cancelled.storeRelease(1);
+    current.clear();
+}
+
+bool FileSearch::isRunning() {
+    return !current.isNull();
+}
+
+//Worker: search one source and hand the hits to the GUI thread
+void FileSearch::searchSource(QSharedPointer<State> state, Source source){
+    if(!state->cancelled.loadAcquire()){
+        QVector<SearchHit> hits;
+        //Notes are HTML too, they are small enough to read at once
+        bool note = !source.hasText && NoteStore::isNote(source.path);
+        if(source.hasText || note){
+            QString text = source.hasText ? source.text : NoteStore::read(source.path);
+            if(source.html || note)
+                text = htmlText(text);
+            hits = match(text, state->query, state->cancelled, 0, text.size(), MAX_FILE_HITS);
+        } else
+            hits = searchFile(source.path, state->query, state->cancelled);
+
+        //Positions are document positions only for the text of an open tab
+        bool exact = source.hasText && !source.html;
+        for(SearchHit &hit : hits) {
+            hit.source = source.id;
+            hit.title = source.title;
+            if(!exact)
+                hit.position = -1;
+        }
+
+        state->files.ref();
+        if(!hits.isEmpty()){
+            state->hits.fetchAndAddRelaxed(hits.size());
+            QMetaObject::invokeMethod(this, [this, state, hits]() {
+                if(state == current)
+                    emit found(hits);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    done(state);
+}
+
+//Worker: queue every file below directory as task of its own
+void FileSearch::searchDirectory(QSharedPointer<State> state, QString directory){
+    QDir root(directory);
+    QDirIterator it(directory, QDir::Files | QDir::Readable | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while(it.hasNext() && !state->cancelled.loadAcquire()){
+        QString path = it.next();
+        QFileInfo info = it.fileInfo();
+        if(info.size() > MAX_FILE_SIZE || state->skip.contains(info.canonicalFilePath()))
+            continue;
+
+        Source source;
+        source.id = path;
+        source.path = path;
+        source.title = root.relativeFilePath(path);
+
+        state->outstanding.ref();
+        pool->start([this, state, source]() { searchSource(state, source); });
+    }
+
+    done(state);
+}
+
+//Task of the search is done. The last one reports the search as finished
+void FileSearch::done(QSharedPointer<State> state){
+    if(state->outstanding.deref())
+        return;
+
+    QMetaObject::invokeMethod(this, [this, state]() {
+        if(state != current)
+            return;
+
+        current.clear();
+        emit finished(state->files.loadAcquire(), state->hits.loadAcquire());
+    }, Qt::QueuedConnection);
+}
+
+//Search a file straight from a memory map. It is decoded a chunk at a time, the end of
+//a chunk is searched again with the next one, so matches across chunks are found too.
+//Nothing for binary files and files that can't be read
+QVector<SearchHit> FileSearch::searchFile(QString path, const Query &query, const QAtomicInt &cancelled){
+    QVector<SearchHit> hits;
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return hits;
+
+    qint64 size = file.size();
+    if(size <= 0 || size > MAX_FILE_SIZE)
+        return hits;
+
+    uchar *data = file.map(0, size);
+    if(data == nullptr)
+        return hits;
+
+    //UTF-16 and UTF-32 text has zero bytes too, other text with them is binary
+    const char *bytes = reinterpret_cast<const char*>(data);
+    QByteArray head = QByteArray::fromRawData(bytes, (int)qMin<qint64>(size, HEAD_SIZE));
+    QTextCodec *codec = TextDecoder::codecFor(head);
+    bool wide = codec->name().startsWith("UTF-16") || codec->name().startsWith("UTF-32");
+    if(!wide && head.left((int)BINARY_PROBE).contains('\0')){
+        file.unmap(data);
+        return hits;
+    }
+
+    //Window is the text not searched yet, after some text before it a regex may look at
+    QScopedPointer<QTextDecoder> decoder(codec->makeDecoder());
+    int overlap = query.regex ? REGEX_OVERLAP : query.pattern.size() - 1;
+    int context = query.regex ? REGEX_OVERLAP : 0;
+    QString window;
+    int from = 0;
+    int line = 0; //Of the start of the window
+    int column = 0;
+    qint64 offset = 0;
+
+    while(offset < size && hits.size() < MAX_FILE_HITS && !cancelled.loadRelaxed()){
+        int length = (int)qMin<qint64>(CHUNK_SIZE, size - offset);
+        window += decoder->toUnicode(bytes + offset, length);
+        offset += length;
+
+        //Matches starting in the last characters are found with the next chunk,
+        //which goes on after the last match like a search of the whole text would
+        int end = offset < size ? qMax(from, window.size() - overlap) : window.size();
+        int next = end;
+        for(SearchHit hit : match(window, query, cancelled, from, end, MAX_FILE_HITS - hits.size())) {
+            next = qMax(next, hit.position + hit.length);
+            if(hit.line == 0)
+                hit.column += column;
+            hit.line += line;
+            hits.append(hit);
+        }
+
+        //Drop what no later match can start in or look at
+        int removed = qMax(0, end - context);
+        QStringRef dropped = window.leftRef(removed);
+        int newlines = dropped.count(QLatin1Char('\n'));
+        line += newlines;
+        column = newlines > 0 ? removed - dropped.lastIndexOf(QLatin1Char('\n')) - 1 : column + removed;
+        window.remove(0, removed);
+        from = next - removed;
+    }
+
+    file.unmap(data);
+    return hits;
+}
+
+//Text an HTML note shows, one line per paragraph. Done by hand, QTextDocument would
+//need fonts and images of the GUI thread
+QString FileSearch::htmlText(QString html){
+    static const QRegularExpression hidden("<(head|style|script)\\b.*?</\\1\\s*>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression space("\\s+");
+    static const QRegularExpression emptyBlock("<br\\s*/?>\\s*(?=</p\\s*>)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression lineEnd("\\s*(</(p|div|li|h[1-6]|tr|pre|blockquote)\\s*>|<br\\s*/?>)\\s*", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression tag("<[^>]*>");
+    static const QRegularExpression code("&#(x?)([0-9a-fA-F]+);");
+
+    html.remove(hidden);
+    html.replace(space, " ");
+    html.remove(emptyBlock);
+    html.replace(lineEnd, "\n");
+    html.remove(tag);
+
+    //Character references, &amp; last so it isn't decoded twice
+    QString text;
+    int last = 0;
+    QRegularExpressionMatchIterator it = code.globalMatch(html);
+    while(it.hasNext()){
+        QRegularExpressionMatch m = it.next();
+        bool ok = false;
+        uint cp = m.captured(2).toUInt(&ok, m.capturedLength(1) > 0 ? 16 : 10);
+        text += html.midRef(last, m.capturedStart() - last);
+        if(ok && cp > 0 && cp <= 0x10FFFF)
+            text += QString::fromUcs4(&cp, 1);
+        last = m.capturedEnd();
+    }
+    text += html.midRef(last);
+
+    text.replace("&lt;", "<").replace("&gt;", ">").replace("&quot;", "\"").replace("&apos;", "'").replace("&nbsp;", QString(QChar(0xA0)));
+    text.replace("&amp;", "&");
+    return text.trimmed();
+}
+
+//Matches starting between from and end in text, limit at most. Lines and columns count from the start of text
+QVector<SearchHit> FileSearch::match(const QString &text, const Query &query, const QAtomicInt &cancelled, int from, int end, int limit){
+    QVector<SearchHit> hits;
+    if(from >= end)
+        return hits;
+
+    const QChar newline(QLatin1Char('\n'));
+    int line = 0;
+    int lineStart = 0;
+    int scanned = 0; //Newlines are counted up to here
+
+    auto add = [&](int position, int length){
+        //Lines between the last hit and this one
+        while(true){
+            int i = FindEngine::indexOf(text.constData() + scanned, position - scanned, &newline, 1);
+            if(i < 0)
+                break;
+
+            line++;
+            scanned += i + 1;
+            lineStart = scanned;
+        }
+        scanned = position;
+
+        int lineEnd = text.indexOf(newline, position);
+        if(lineEnd < 0)
+            lineEnd = text.size();
+
+        int from = qMax(lineStart, position - PREVIEW_BEFORE);
+        int to = qMin(lineEnd, from + PREVIEW_LENGTH);
+
+        SearchHit hit;
+        hit.line = line;
+        hit.column = position - lineStart;
+        hit.position = position;
+        hit.length = length;
+        hit.text = text.mid(from, to - from).trimmed();
+        hits.append(hit);
+    };
+
+    if(query.regex){
+        QRegularExpression expression(query.pattern, QRegularExpression::MultilineOption
+                                      | (query.caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption));
+        QRegularExpressionMatchIterator it = expression.globalMatch(text, from);
+        while(it.hasNext() && hits.size() < limit && !cancelled.loadRelaxed()){
+            QRegularExpressionMatch m = it.next();
+            if(m.capturedStart() >= end)
+                break;
+            if(m.capturedLength() > 0)
+                add(m.capturedStart(), m.capturedLength());
+        }
+        return hits;
+    }
+
+    //Qt folds one UTF-16 unit to one, so offsets in folded text are the same
+    QString folded = query.caseSensitive ? QString() : text.toCaseFolded();
+    const QString &haystack = query.caseSensitive ? text : folded;
+    QString needle = query.caseSensitive ? query.pattern : query.pattern.toCaseFolded();
+
+    int offset = from;
+    while(hits.size() < limit && !cancelled.loadRelaxed()){
+        int i = FindEngine::indexOf(haystack.constData() + offset, haystack.size() - offset, needle.constData(), needle.size());
+        if(i < 0 || offset + i >= end)
+            break;
+
+        add(offset + i, needle.size());
+        offset += i + needle.size();
+    }
+
+    return hits;
+}
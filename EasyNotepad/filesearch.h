@@ -0,0 +1,77 @@
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QVector>
+#include <QSet>
+
+//Line with a match of a find in files search
+struct SearchHit {
+    QString source; //Tab id for open tabs, else the file path
+    QString title;
+    int line = 0; //Zero based
+    int column = 0;
+    int position = -1; //In the document of an open tab, -1 for other files
+    int length = 0;
+    QString text;
+};
+
+//Searches open tabs and directory trees on a worker pool. Every file is a task of
+//its own, so a worker that is done takes the next file. Results are handed to the
+//GUI thread per file. Starting a new search cancels the running one
+class FileSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    //Something to search in: text of an open tab, or a file to read
+    struct Source {
+        QString id;
+        QString title;
+        QString path;
+        QString text;
+        bool hasText = false; //Else the file is read
+        bool html = false; //Text (or file) is HTML, searched as the plain text it shows
+    };
+
+    explicit FileSearch(QObject *parent = nullptr);
+    ~FileSearch();
+    void start(QString pattern, bool regex, bool caseSensitive, QList<Source> sources, QString directory = QString());
+    void cancel();
+    bool isRunning();
+
+signals:
+    void found(QVector<SearchHit> hits);
+    void finished(int files, int hits);
+
+private:
+    struct Query {
+        QString pattern;
+        bool regex = false;
+        bool caseSensitive = false;
+    };
+
+    //Shared by the tasks of one search
+    struct State {
+        Query query;
+        QSet<QString> skip; //Files that are open, they are searched as tab
+        QAtomicInt cancelled;
+        QAtomicInt outstanding;
+        QAtomicInt files;
+        QAtomicInt hits;
+    };
+
+    QThreadPool *pool;
+    QSharedPointer<State> current;
+    void searchSource(QSharedPointer<State> state, Source source);
+    void searchDirectory(QSharedPointer<State> state, QString directory);
+    void done(QSharedPointer<State> state);
+    static QVector<SearchHit> searchFile(QString path, const Query &query, const QAtomicInt &cancelled);
+    static QString htmlText(QString html);
+    static QVector<SearchHit> match(const QString &text, const Query &query, const QAtomicInt &cancelled, int from, int end, int limit);
+};
+
+#endif // FILESEARCH_H
@@ -0,0 +1,140 @@
+#include "filestreamer.h"
+
+#include <QTextCodec>
+#include <QTextCursor>
+#include <QElapsedTimer>
+#include <iostream>
+
+//Files bigger than this are streamed instead of loaded at once
+static const qint64 STREAM_THRESHOLD = 8 * 1024 * 1024;
+//Bytes decoded and appended per step
+static const qint64 CHUNK_SIZE = 256 * 1024;
+//Max time (ms) spent per event loop iteration, so input and painting keep going
+static const qint64 TICK_BUDGET = 15;
+
+FileStreamer::FileStreamer(QObject *parent) : QObject(parent)
+{
+    this->document = nullptr;
+    this->file = nullptr;
+    this->decoder = nullptr;
+    this->data = nullptr;
+    this->size = 0;
+    this->offset = 0;
+    this->running = false;
+
+    timer = new QTimer(this);
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &FileStreamer::loadChunk);
+}
+
+FileStreamer::~FileStreamer()
+{
+    stop();
+}
+
+bool FileStreamer::shouldStream(qint64 size) {
+    return size > STREAM_THRESHOLD;
+}
+
+//Map file and load the first screenful with the codec detected from its head.
+//Returns false if the file can't be mapped
+bool FileStreamer::start(QString fileName, QTextDocument *document, QTextCodec *codec){
+    stop();
+    this->document = document;
+
+    file = new QFile(fileName);
+    if(!file->open(QIODevice::ReadOnly)){
+        std::cerr << "ERROR: Failed to read file" << std::endl;
+        stop();
+        return false;
+    }
+
+    size = file->size();
+    data = file->map(0, size);
+    if(data == nullptr){
+        std::cerr << "ERROR: Failed to map file" << std::endl;
+        stop();
+        return false;
+    }
+
+    decoder = codec->makeDecoder();
+
+    offset = 0;
+    pending.clear();
+    running = true;
+
+    //No undo history for the initial content
+    document->setUndoRedoEnabled(false);
+    appendChunk();
+    timer->start();
+    return true;
+}
+
+void FileStreamer::cancel() {
+    if(!running)
+        return;
+
+    stop();
+    emit finished(false);
+}
+
+bool FileStreamer::isRunning() {
+    return running;
+}
+
+void FileStreamer::loadChunk(){
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    while(offset < size && elapsed.elapsed() < TICK_BUDGET){
+        appendChunk();
+    }
+
+    emit progress(size > 0 ? (int)(offset * 100 / size) : 100);
+
+    if(offset >= size){
+        stop();
+        emit finished(true);
+    }
+}
+
+//Decode next chunk and append it to the end of the document
+void FileStreamer::appendChunk(){
+    qint64 len = qMin(CHUNK_SIZE, size - offset);
+    //Decoder keeps state, so multibyte chars split over chunks are fine
+    QString text = pending + decoder->toUnicode(reinterpret_cast<const char*>(data + offset), (int)len);
+    offset += len;
+    pending.clear();
+
+    //Keep \r\n together, else it becomes two blocks
+    if(offset < size && text.endsWith(QLatin1Char('\r'))){
+        text.chop(1);
+        pending = QLatin1String("\r");
+    }
+
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+}
+
+void FileStreamer::stop(){
+    timer->stop();
+
+    if(running){
+        document->setUndoRedoEnabled(true);
+    }
+
+    if(file != nullptr){
+        if(data != nullptr)
+            file->unmap(data);
+        file->close();
+        delete file;
+    }
+
+    delete decoder;
+    file = nullptr;
+    decoder = nullptr;
+    data = nullptr;
+    pending.clear();
+    running = false;
+}
@@ -0,0 +1,45 @@
+#ifndef FILESTREAMER_H
+#define FILESTREAMER_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QTextDocument>
+#include <QTextDecoder>
+
+//Streams a big plain text file into a document: the file is memory-mapped,
+//decoded chunk by chunk and appended from the event loop, so the tab stays usable
+class FileStreamer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileStreamer(QObject *parent = nullptr);
+    ~FileStreamer();
+    bool start(QString fileName, QTextDocument *document, QTextCodec *codec);
+    void cancel();
+    bool isRunning();
+    static bool shouldStream(qint64 size);
+
+signals:
+    void progress(int percent);
+    void finished(bool ok);
+
+private slots:
+    void loadChunk();
+
+private:
+    QTextDocument *document;
+    QFile *file;
+    QTimer *timer;
+    QTextDecoder *decoder;
+    uchar *data;
+    qint64 size;
+    qint64 offset;
+    QString pending;
+    bool running;
+    void appendChunk();
+    void stop();
+};
+
+#endif // FILESTREAMER_H
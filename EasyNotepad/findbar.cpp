@@ -0,0 +1,80 @@
+#include "findbar.h"
+
+#include <QGridLayout>
+#include <QShortcut>
+
+FindBar::FindBar(QWidget *parent) : QWidget(parent)
+{
+    tbFind = new QLineEdit(this);
+    tbFind->setPlaceholderText("Find");
+    tbFind->setClearButtonEnabled(true);
+    tbReplace = new QLineEdit(this);
+    tbReplace->setPlaceholderText("Replace with");
+    cbRegex = new QCheckBox("Regex", this);
+    cbCase = new QCheckBox("Match case", this);
+    btnPrevious = new QPushButton("Previous", this);
+    btnNext = new QPushButton("Next", this);
+    btnReplace = new QPushButton("Replace", this);
+    btnReplaceAll = new QPushButton("Replace all", this);
+    btnClose = new QPushButton("\u2715", this);
+    btnClose->setFlat(true);
+    btnClose->setToolTip("Close (Esc)");
+    lblStatus = new QLabel(this);
+    lblStatus->setMinimumWidth(120);
+
+    QGridLayout *layout = new QGridLayout(this);
+    layout->setContentsMargins(3, 3, 3, 3);
+    layout->addWidget(tbFind, 0, 0);
+    layout->addWidget(btnPrevious, 0, 1);
+    layout->addWidget(btnNext, 0, 2);
+    layout->addWidget(cbCase, 0, 3);
+    layout->addWidget(cbRegex, 0, 4);
+    layout->addWidget(lblStatus, 0, 5);
+    layout->addWidget(btnClose, 0, 6);
+    layout->addWidget(tbReplace, 1, 0);
+    layout->addWidget(btnReplace, 1, 1);
+    layout->addWidget(btnReplaceAll, 1, 2);
+    layout->setColumnStretch(0, 1);
+
+    connect(tbFind, &QLineEdit::textChanged, this, &FindBar::patternChanged);
+    connect(cbRegex, &QCheckBox::toggled, this, &FindBar::patternChanged);
+    connect(cbCase, &QCheckBox::toggled, this, &FindBar::patternChanged);
+    connect(tbFind, &QLineEdit::returnPressed, this, [this]() { emit findNext(false); });
+    connect(btnNext, &QPushButton::clicked, this, [this]() { emit findNext(false); });
+    connect(btnPrevious, &QPushButton::clicked, this, [this]() { emit findNext(true); });
+    connect(tbReplace, &QLineEdit::returnPressed, this, &FindBar::replace);
+    connect(btnReplace, &QPushButton::clicked, this, &FindBar::replace);
+    connect(btnReplaceAll, &QPushButton::clicked, this, &FindBar::replaceAll);
+    connect(btnClose, &QPushButton::clicked, this, &FindBar::closed);
+
+    QShortcut *escape = new QShortcut(QKeySequence(Qt::Key_Escape), this);
+    escape->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(escape, &QShortcut::activated, this, &FindBar::closed);
+
+    hide();
+}
+
+//Show bar, with the replace row or without. Text is the initial pattern, e.g. the selection
+void FindBar::open(bool replace, QString text){
+    tbReplace->setVisible(replace);
+    btnReplace->setVisible(replace);
+    btnReplaceAll->setVisible(replace);
+
+    if(!text.isEmpty())
+        tbFind->setText(text);
+
+    show();
+    tbFind->setFocus();
+    tbFind->selectAll();
+}
+
+QString FindBar::pattern() { return tbFind->text(); }
+QString FindBar::replacement() { return tbReplace->text(); }
+bool FindBar::isRegex() { return cbRegex->isChecked(); }
+bool FindBar::isCaseSensitive() { return cbCase->isChecked(); }
+
+//Number of matches, or what is wrong with the pattern
+void FindBar::setStatus(QString text, bool error){
+    lblStatus->setText(text);
+    lblStatus->setStyleSheet(error ? "color: red;" : "");
+}
@@ -0,0 +1,44 @@
+#ifndef FINDBAR_H
+#define FINDBAR_H
+
+#include <QWidget>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+
+//Find and replace fields shown below the editor of a tab
+class FindBar : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindBar(QWidget *parent = nullptr);
+    void open(bool replace, QString text = QString());
+    QString pattern();
+    QString replacement();
+    bool isRegex();
+    bool isCaseSensitive();
+    void setStatus(QString text, bool error = false);
+
+signals:
+    void patternChanged();
+    void findNext(bool backward);
+    void replace();
+    void replaceAll();
+    void closed();
+
+private:
+    QLineEdit *tbFind;
+    QLineEdit *tbReplace;
+    QCheckBox *cbRegex;
+    QCheckBox *cbCase;
+    QPushButton *btnPrevious;
+    QPushButton *btnNext;
+    QPushButton *btnReplace;
+    QPushButton *btnReplaceAll;
+    QPushButton *btnClose;
+    QLabel *lblStatus;
+};
+
+#endif // FINDBAR_H
@@ -0,0 +1,331 @@
+#include "findengine.h"
+
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FIND_SSE2
+#include <emmintrin.h>
+#endif
+
+//Max time (ms) spent highlighting per event loop iteration, so input and painting keep going
+static const qint64 TICK_BUDGET = 10;
+
+FindEngine::FindEngine(QObject *parent) : QObject(parent)
+{
+    this->document = nullptr;
+    this->regex = false;
+    this->caseSensitive = false;
+    this->stopBlock = 0;
+    this->wrapped = false;
+    this->matches = 0;
+    this->running = false;
+
+    timer = new QTimer(this);
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &FindEngine::scanChunk);
+}
+
+//Set what to look for. Returns false if the regular expression is invalid
+bool FindEngine::setPattern(QString pattern, bool regex, bool caseSensitive){
+    cancel();
+    this->pattern = pattern;
+    this->regex = regex;
+    this->caseSensitive = caseSensitive;
+    //Qt folds one UTF-16 unit to one, so offsets in folded text are the same
+    this->folded = pattern.toCaseFolded();
+
+    if(!regex)
+        return true;
+
+    expression.setPattern(pattern);
+    expression.setPatternOptions(caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+    return expression.isValid();
+}
+
+QString FindEngine::errorString() {
+    return (regex && !expression.isValid()) ? expression.errorString() : QString();
+}
+
+bool FindEngine::isEmpty() {
+    return pattern.isEmpty() || (regex && !expression.isValid());
+}
+
+//First match from position on, or the last match before it. Wraps around the document.
+//Returns a null cursor if there is no match. The match with its groups goes to match if given
+QTextCursor FindEngine::find(QTextDocument *document, int from, bool backward, Match *match){
+    if(isEmpty())
+        return QTextCursor();
+
+    QTextBlock start = document->findBlock(from);
+    QTextBlock block = start;
+    bool wrap = false;
+
+    while(block.isValid()){
+        QVector<Match> found = matchBlock(block, match != nullptr);
+        Match hit;
+
+        if(!backward){
+            for(const Match &m : found){
+                //The part of the start block before from is checked after wrapping
+                if(wrap && block == start ? m.position < from : (block != start || m.position >= from)){
+                    hit = m;
+                    break;
+                }
+            }
+        } else {
+            for(int i = found.size() - 1; i >= 0; i--){
+                const Match &m = found[i];
+                if(wrap && block == start ? m.position + m.length > from : (block != start || m.position + m.length <= from)){
+                    hit = m;
+                    break;
+                }
+            }
+        }
+
+        if(hit.position >= 0){
+            if(match != nullptr)
+                *match = hit;
+            QTextCursor cursor(document);
+            cursor.setPosition(hit.position);
+            cursor.setPosition(hit.position + hit.length, QTextCursor::KeepAnchor);
+            return cursor;
+        }
+
+        if(wrap && block == start)
+            break;
+
+        block = backward ? block.previous() : block.next();
+        if(!block.isValid() && !wrap){
+            block = backward ? document->lastBlock() : document->begin();
+            wrap = true;
+        }
+    }
+
+    return QTextCursor();
+}
+
+//Replace every match as one undo step. Returns the number of replacements
+int FindEngine::replaceAll(QTextDocument *document, QString replacement){
+    if(isEmpty())
+        return 0;
+
+    cancel();
+
+    QVector<Match> found;
+    scanBlocks(document->begin(), -1, found, regex);
+    if(found.isEmpty())
+        return 0;
+
+    //Back to front, so the positions of the matches before stay valid
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    for(int i = found.size() - 1; i >= 0; i--){
+        cursor.setPosition(found[i].position);
+        cursor.setPosition(found[i].position + found[i].length, QTextCursor::KeepAnchor);
+        cursor.insertText(replacementFor(found[i], replacement));
+    }
+    cursor.endEditBlock();
+
+    return found.size();
+}
+
+//Replacement for a match. For regular expressions \0 to \9 are the groups it captured
+//in its block, so lookbehinds and word boundaries keep their context
+QString FindEngine::replacementFor(const Match &match, QString replacement){
+    if(!regex)
+        return replacement;
+
+    QString result;
+    result.reserve(replacement.size());
+    for(int i = 0; i < replacement.size(); i++){
+        QChar c = replacement[i];
+        if(c == QLatin1Char('\\') && i + 1 < replacement.size()){
+            QChar n = replacement[++i];
+            if(n.isDigit())
+                result += match.captured.value(n.digitValue());
+            else if(n == QLatin1Char('n'))
+                result += QChar::ParagraphSeparator;
+            else if(n == QLatin1Char('t'))
+                result += QLatin1Char('\t');
+            else
+                result += n;
+        } else
+            result += c;
+    }
+
+    return result;
+}
+
+//Highlight the given blocks at once, then the rest of the document from the event loop
+void FindEngine::highlight(QTextDocument *document, int firstBlock, int lastBlock){
+    cancel();
+    this->document = document;
+    matches = 0;
+
+    if(isEmpty()){
+        emit finished(0);
+        return;
+    }
+
+    QVector<Match> visible;
+    QTextBlock first = document->findBlockByNumber(firstBlock);
+    if(!first.isValid())
+        first = document->begin();
+
+    scanBlocks(first, lastBlock, visible);
+    matches = visible.size();
+    emit found(visible);
+
+    next = document->findBlockByNumber(lastBlock).next();
+    stopBlock = first.blockNumber();
+    wrapped = false;
+    running = true;
+    timer->start();
+}
+
+void FindEngine::cancel(){
+    timer->stop();
+    running = false;
+    next = QTextBlock();
+}
+
+bool FindEngine::isRunning() {
+    return running;
+}
+
+//Matches highlighted so far
+int FindEngine::count() {
+    return matches;
+}
+
+void FindEngine::scanChunk(){
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QVector<Match> result;
+    bool done = false;
+    while(elapsed.elapsed() < TICK_BUDGET){
+        if(!next.isValid()){
+            if(wrapped){
+                done = true;
+                break;
+            }
+
+            next = document->begin();
+            wrapped = true;
+        }
+
+        if(wrapped && next.blockNumber() >= stopBlock){
+            done = true;
+            break;
+        }
+
+        result += matchBlock(next);
+        next = next.next();
+    }
+
+    matches += result.size();
+    if(!result.isEmpty())
+        emit found(result);
+
+    if(done){
+        cancel();
+        emit finished(matches);
+    }
+}
+
+//Matches of block from block up to and including block number last, -1 for the end
+void FindEngine::scanBlocks(QTextBlock block, int last, QVector<Match> &result, bool captures){
+    for(; block.isValid(); block = block.next()){
+        if(last >= 0 && block.blockNumber() > last)
+            break;
+
+        result += matchBlock(block, captures);
+    }
+}
+
+//Non overlapping matches in a block, with document positions. With captures set, regex
+//matches keep their groups
+QVector<FindEngine::Match> FindEngine::matchBlock(const QTextBlock &block, bool captures){
+    QVector<Match> result;
+    int base = block.position();
+
+    if(regex){
+        QRegularExpressionMatchIterator it = expression.globalMatch(block.text());
+        while(it.hasNext()){
+            QRegularExpressionMatch m = it.next();
+            if(m.capturedLength() == 0)
+                continue;
+
+            Match match;
+            match.position = base + m.capturedStart();
+            match.length = m.capturedLength();
+            if(captures)
+                match.captured = m.capturedTexts();
+            result.append(match);
+        }
+        return result;
+    }
+
+    QString text = caseSensitive ? block.text() : block.text().toCaseFolded();
+    const QString &needle = caseSensitive ? pattern : folded;
+    int offset = 0;
+    while(true){
+        int i = indexOf(text.constData() + offset, text.size() - offset, needle.constData(), needle.size());
+        if(i < 0)
+            break;
+
+        Match match;
+        match.position = base + offset + i;
+        match.length = needle.size();
+        result.append(match);
+        offset += i + needle.size();
+    }
+
+    return result;
+}
+
+//Position of needle in text, or -1. With SSE2 eight positions are checked per step:
+//the first and last character of the needle are compared at once, only candidates
+//that have both are compared in full
+int FindEngine::indexOf(const QChar *text, int length, const QChar *needle, int needleLength){
+    if(needleLength <= 0 || needleLength > length)
+        return -1;
+
+    const ushort *h = reinterpret_cast<const ushort*>(text);
+    const ushort *n = reinterpret_cast<const ushort*>(needle);
+    const size_t middle = (size_t)qMax(0, needleLength - 2) * sizeof(ushort);
+    const int last = length - needleLength; //Last position the needle fits
+    int i = 0;
+
+#ifdef FIND_SSE2
+    const __m128i first = _mm_set1_epi16((short)n[0]);
+    const __m128i end = _mm_set1_epi16((short)n[needleLength - 1]);
+
+    for(; i + 7 <= last; i += 8){
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + needleLength - 1));
+        uint mask = (uint)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(first, a), _mm_cmpeq_epi16(end, b)));
+
+        //Two mask bits per character
+        while(mask != 0){
+            uint bit = qCountTrailingZeroBits(mask);
+            int pos = i + (int)(bit / 2);
+            if(middle == 0 || memcmp(h + pos + 1, n + 1, middle) == 0)
+                return pos;
+
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+
+    for(; i <= last; i++){
+        if(h[i] == n[0] && h[i + needleLength - 1] == n[needleLength - 1]
+                && (middle == 0 || memcmp(h + i + 1, n + 1, middle) == 0))
+            return i;
+    }
+
+    return -1;
+}
@@ -0,0 +1,63 @@
+#ifndef FINDENGINE_H
+#define FINDENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QRegularExpression>
+
+//Finds text in a document block by block. Literal patterns are scanned with SSE2 where
+//available, else with a plain loop. Regular expressions go through QRegularExpression.
+//Matches never span blocks. Highlighting runs from the event loop, visible blocks first
+class FindEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Match {
+        int position = -1;
+        int length = 0;
+        QStringList captured; //Groups of a regex match, only where it is replaced
+    };
+
+    explicit FindEngine(QObject *parent = nullptr);
+    bool setPattern(QString pattern, bool regex, bool caseSensitive);
+    QString errorString();
+    bool isEmpty();
+    QTextCursor find(QTextDocument *document, int from, bool backward = false, Match *match = nullptr);
+    int replaceAll(QTextDocument *document, QString replacement);
+    QString replacementFor(const Match &match, QString replacement);
+    void highlight(QTextDocument *document, int firstBlock, int lastBlock);
+    void cancel();
+    bool isRunning();
+    int count();
+    static int indexOf(const QChar *text, int length, const QChar *needle, int needleLength);
+
+signals:
+    void found(QVector<FindEngine::Match> matches);
+    void finished(int count);
+
+private slots:
+    void scanChunk();
+
+private:
+    QTextDocument *document;
+    QTimer *timer;
+    QString pattern;
+    QString folded; //Pattern in lower case, for literal search that ignores case
+    QRegularExpression expression;
+    bool regex;
+    bool caseSensitive;
+    QTextBlock next; //Next block to highlight
+    int stopBlock; //Block number where highlighting started, it wraps around to it
+    bool wrapped;
+    int matches;
+    bool running;
+    QVector<Match> matchBlock(const QTextBlock &block, bool captures = false);
+    void scanBlocks(QTextBlock block, int last, QVector<Match> &result, bool captures = false);
+};
+
+#endif // FINDENGINE_H
@@ -0,0 +1,134 @@
+#include "imageloader.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTextBlock>
+#include <QTextFormat>
+#include <QThreadPool>
+#include <QTimer>
+
+//Memory (KB) of the decoded images in the cache
+#define CACHE_SIZE (64 * 1024)
+//Time (ms) to wait for more images before the documents are laid out again
+#define RELAYOUT_DELAY 50
+//Placeholders are never bigger than this, the document scales them to the image size
+#define MAX_PLACEHOLDER 1024
+
+QCache<QString, QImage> ImageLoader::cache(CACHE_SIZE);
+QList<ImageLoader::Dirty> ImageLoader::dirty;
+
+//Start loading the images of the document. Remote and data URLs are left to the document
+void ImageLoader::load(QTextDocument *document, qreal pixelRatio){
+    QSet<QString> names;
+    for(const QTextFormat &format : document->allFormats()){
+        if(!format.isImageFormat())
+            continue;
+
+        QTextImageFormat image = format.toImageFormat();
+        QString name = image.name();
+        if(name.isEmpty() || names.contains(name))
+            continue;
+        names.insert(name);
+
+        QString path;
+        if(name.startsWith(QLatin1Char(':')))
+            path = name;
+        else {
+            QUrl url = document->baseUrl().resolved(QUrl(name));
+            if(url.isLocalFile())
+                path = url.toLocalFile();
+            else if(url.scheme() == QLatin1String("qrc"))
+                path = QLatin1Char(':') + url.path();
+        }
+
+        QFileInfo info(path);
+        if(path.isEmpty() || !info.exists())
+            continue;
+
+        //Size in the document, in device pixels
+        QSize size(qRound(image.width() * pixelRatio), qRound(image.height() * pixelRatio));
+        QString key = QString("%1|%2|%3x%4").arg(info.absoluteFilePath()).arg(info.lastModified().toMSecsSinceEpoch()).arg(size.width()).arg(size.height());
+
+        QUrl resource(name);
+        if(QImage *cached = cache.object(key)){
+            document->addResource(QTextDocument::ImageResource, resource, *cached);
+            continue;
+        }
+
+        document->addResource(QTextDocument::ImageResource, resource, placeholder(QSize(qRound(image.width()), qRound(image.height()))));
+
+        QPointer<QTextDocument> target(document);
+        QThreadPool::globalInstance()->start([target, name, key, path, size]() {
+            QImageReader reader(path);
+            reader.setAutoTransform(true);
+
+            //Decode at the size it is shown at, one side is enough to keep the aspect ratio
+            QSize original = reader.size();
+            if(original.isValid() && (size.width() > 0 || size.height() > 0)){
+                QSize scaled = original.scaled(size.width() > 0 ? size.width() : original.width(),
+                                               size.height() > 0 ? size.height() : original.height(),
+                                               size.width() > 0 && size.height() > 0 ? Qt::IgnoreAspectRatio : Qt::KeepAspectRatio);
+                if(scaled.width() < original.width() || scaled.height() < original.height())
+                    reader.setScaledSize(scaled);
+            }
+
+            QImage image = reader.read();
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [target, name, key, image]() {
+                loaded(target, name, key, image);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+//Light box of the size in the document, or a small one
+QImage ImageLoader::placeholder(QSize size){
+    if(size.width() <= 0 || size.height() <= 0)
+        size = QSize(32, 32);
+
+    QImage image(size.boundedTo(QSize(MAX_PLACEHOLDER, MAX_PLACEHOLDER)), QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(128, 128, 128, 40));
+    return image;
+}
+
+//Image is decoded. Documents are laid out once for all images that are done meanwhile
+void ImageLoader::loaded(QPointer<QTextDocument> document, QString name, QString key, QImage image){
+    if(image.isNull())
+        return;
+
+    cache.insert(key, new QImage(image), qMax<qint64>(1, image.sizeInBytes() / 1024));
+    if(document.isNull())
+        return;
+
+    document->addResource(QTextDocument::ImageResource, QUrl(name), image);
+    if(dirty.isEmpty())
+        QTimer::singleShot(RELAYOUT_DELAY, QCoreApplication::instance(), &ImageLoader::relayout);
+
+    for(Dirty &entry : dirty){
+        if(entry.document == document){
+            entry.names.insert(name);
+            return;
+        }
+    }
+    dirty.append({document, QSet<QString>() << name});
+}
+
+//Lay out only the characters that show one of the decoded images
+void ImageLoader::relayout(){
+    for(const Dirty &entry : dirty){
+        QTextDocument *document = entry.document;
+        if(document == nullptr)
+            continue;
+
+        for(QTextBlock block = document->begin(); block.isValid(); block = block.next()){
+            for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it){
+                QTextFragment fragment = it.fragment();
+                QTextCharFormat format = fragment.charFormat();
+                if(format.isImageFormat() && entry.names.contains(format.toImageFormat().name()))
+                    document->markContentsDirty(fragment.position(), fragment.length());
+            }
+        }
+    }
+    dirty.clear();
+}
@@ -0,0 +1,36 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QPointer>
+#include <QSet>
+#include <QTextDocument>
+#include <QUrl>
+
+//Loads the images of a document on the global pool, instead of the document reading
+//them one by one while it is laid out. Each image is a placeholder until it is decoded.
+//Images with a size in the document are decoded at that size. Decoded images are kept
+//in a cache shared by all documents, the least recently used go first
+class ImageLoader
+{
+public:
+    static void load(QTextDocument *document, qreal pixelRatio);
+
+private:
+    //Images of a document that are decoded since it was laid out
+    struct Dirty {
+        QPointer<QTextDocument> document;
+        QSet<QString> names;
+    };
+
+    static QCache<QString, QImage> cache;
+    static QList<Dirty> dirty;
+
+    static QImage placeholder(QSize size);
+    static void loaded(QPointer<QTextDocument> document, QString name, QString key, QImage image);
+    static void relayout();
+};
+
+#endif // IMAGELOADER_H
@@ -0,0 +1,483 @@
+#include "largefileview.h"
+
+#include <QPainter>
+#include <QScrollBar>
+#include <QKeyEvent>
+#include <QByteArrayMatcher>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+//Files bigger than this are shown in the viewer instead of the editor
+static const qint64 VIEW_THRESHOLD = 256 * 1024 * 1024;
+//Every LINE_STRIDE'th line offset is kept in the index
+static const int LINE_STRIDE = 1024;
+//Bytes indexed before the GUI gets the new part of the index
+static const qint64 INDEX_STEP = 32 * 1024 * 1024;
+//Bytes searched per step, so a new search can stop the old one
+static const qint64 SEARCH_CHUNK = 4 * 1024 * 1024;
+//Longer lines are cut off when shown
+static const qint64 MAX_LINE_BYTES = 16 * 1024;
+//Space (px) around the line numbers
+static const int MARGIN = 6;
+
+//Start of the line offset is in
+static qint64 startOfLine(const char *data, qint64 offset){
+    while(offset > 0 && data[offset - 1] != '\n')
+        offset--;
+    return offset;
+}
+
+LargeFileView::LargeFileView(QWidget *parent) : QAbstractScrollArea(parent)
+{
+    this->file = nullptr;
+    this->data = nullptr;
+    this->size = 0;
+    this->codec = nullptr;
+    this->lines = 1;
+    this->indexing = false;
+    this->selectionLine = -1;
+    this->selectionColumn = 0;
+    this->selectionLength = 0;
+    this->widest = 0;
+
+    //One worker builds the index, the other searches
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(2);
+
+    setFocusPolicy(Qt::StrongFocus);
+    setFrameStyle(QFrame::NoFrame);
+    viewport()->setCursor(Qt::IBeamCursor);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LargeFileView::lineChanged);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LargeFileView::measureLines);
+}
+
+LargeFileView::~LargeFileView()
+{
+    stop();
+}
+
+bool LargeFileView::shouldView(qint64 size) {
+    return size > VIEW_THRESHOLD;
+}
+
+//Map the file and start indexing it. Returns false if it can't be mapped or isn't 8 bit based text
+bool LargeFileView::open(QString fileName){
+    stop();
+
+    file = new QFile(fileName);
+    if(!file->open(QIODevice::ReadOnly)){
+        std::cerr << "ERROR: Failed to read file" << std::endl;
+        stop();
+        return false;
+    }
+
+    size = file->size();
+    data = reinterpret_cast<const char*>(file->map(0, size));
+    if(data == nullptr){
+        std::cerr << "ERROR: Failed to map file" << std::endl;
+        stop();
+        return false;
+    }
+
+    //Lines are split on '\n' bytes, that doesn't work for UTF-16 and UTF-32
+    QByteArray head = QByteArray::fromRawData(data, (int)qMin<qint64>(size, 4));
+    QTextCodec *bom = QTextCodec::codecForUtfText(head, nullptr);
+    codec = bom != nullptr ? bom : QTextCodec::codecForLocale();
+    if(bom != nullptr && bom->mibEnum() != 106){ //Not UTF-8
+        stop();
+        return false;
+    }
+
+    cancelled.storeRelease(0);
+    checkpoints.clear();
+    checkpoints.append(0);
+    lines = 1;
+    widest = 0;
+    selectionLine = -1;
+    updateScrollBars();
+    measureLines();
+    startIndex();
+    return true;
+}
+
+void LargeFileView::stop(){
+    cancelled.storeRelease(1);
+    searches.ref();
+    pool->clear();
+    pool->waitForDone();
+
+    if(file != nullptr){
+        if(data != nullptr)
+            file->unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+        file->close();
+        delete file;
+    }
+
+    file = nullptr;
+    data = nullptr;
+    size = 0;
+    indexing = false;
+}
+
+int LargeFileView::lineCount() { return lines; }
+bool LargeFileView::isIndexing() { return indexing; }
+int LargeFileView::currentLine() { return verticalScrollBar()->value(); }
+
+//Count lines in background. The GUI gets the index piece by piece, so the part that is done can be used
+void LargeFileView::startIndex(){
+    indexing = true;
+    const char *data = this->data;
+    qint64 size = this->size;
+
+    pool->start([this, data, size]() {
+        QVector<qint64> batch;
+        qint64 newlines = 0;
+        qint64 pos = 0;
+        qint64 posted = 0;
+
+        while(pos < size && !cancelled.loadRelaxed()){
+            const char *nl = static_cast<const char*>(memchr(data + pos, '\n', (size_t)(size - pos)));
+            if(nl == nullptr)
+                break;
+
+            pos = nl - data + 1;
+            if(++newlines % LINE_STRIDE == 0)
+                batch.append(pos);
+
+            if(pos - posted >= INDEX_STEP){
+                int count = (int)qMin<qint64>(newlines + 1, INT_MAX);
+                QMetaObject::invokeMethod(this, [this, batch, count]() { addCheckpoints(batch, count, false); }, Qt::QueuedConnection);
+                batch.clear();
+                posted = pos;
+            }
+        }
+
+        if(cancelled.loadRelaxed())
+            return;
+
+        int count = (int)qMin<qint64>(newlines + 1, INT_MAX);
+        QMetaObject::invokeMethod(this, [this, batch, count]() { addCheckpoints(batch, count, true); }, Qt::QueuedConnection);
+    });
+}
+
+void LargeFileView::addCheckpoints(QVector<qint64> batch, int count, bool done){
+    checkpoints += batch;
+    lines = count;
+    updateScrollBars();
+    measureLines();
+    viewport()->update();
+
+    if(done){
+        indexing = false;
+        emit indexed(lines);
+    }
+}
+
+//Offset of a line: from the nearest line in the index, count the rest. Lines past the
+//part that is indexed so far are clamped to it, so at most LINE_STRIDE lines are counted
+qint64 LargeFileView::lineOffset(int line){
+    line = qBound(0, line, lines - 1);
+    int k = qMin(line / LINE_STRIDE, checkpoints.size() - 1);
+    qint64 offset = checkpoints[k];
+    for(int i = k * LINE_STRIDE; i < line && offset < size; i++){
+        const char *nl = static_cast<const char*>(memchr(data + offset, '\n', (size_t)(size - offset)));
+        if(nl == nullptr)
+            return size;
+        offset = nl - data + 1;
+    }
+    return offset;
+}
+
+//Line that offset is in
+int LargeFileView::lineAt(qint64 offset){
+    int k = (int)(std::upper_bound(checkpoints.begin(), checkpoints.end(), offset) - checkpoints.begin()) - 1;
+    int line = qMax(0, k) * LINE_STRIDE;
+    qint64 pos = checkpoints[qMax(0, k)];
+    while(pos < offset){
+        const char *nl = static_cast<const char*>(memchr(data + pos, '\n', (size_t)(offset - pos)));
+        if(nl == nullptr)
+            break;
+        pos = nl - data + 1;
+        line++;
+    }
+    return line;
+}
+
+qint64 LargeFileView::lineEnd(qint64 offset){
+    const char *nl = static_cast<const char*>(memchr(data + offset, '\n', (size_t)(size - offset)));
+    return nl == nullptr ? size : nl - data;
+}
+
+QString LargeFileView::lineText(qint64 offset, qint64 end){
+    QString text = codec->toUnicode(data + offset, (int)qMin(end - offset, MAX_LINE_BYTES));
+    if(text.endsWith(QLatin1Char('\r')))
+        text.chop(1);
+    return text;
+}
+
+int LargeFileView::visibleLines() {
+    return qMax(1, viewport()->height() / qMax(1, fontMetrics().height()));
+}
+
+//Widest line that was in view, for the horizontal scroll bar. Measured when lines come
+//into view, painting only reads it
+void LargeFileView::measureLines(){
+    if(data == nullptr)
+        return;
+
+    QFontMetrics fm = fontMetrics();
+    int rows = visibleLines() + 1;
+    qint64 offset = lineOffset(verticalScrollBar()->value());
+    int before = widest;
+    for(int i = 0; i < rows && offset < size; i++){
+        qint64 end = lineEnd(offset);
+        QString text = lineText(offset, end);
+        text.replace(QLatin1Char('\t'), QLatin1String("    "));
+        widest = qMax(widest, fm.horizontalAdvance(text));
+        offset = end + 1;
+    }
+}
+
+void LargeFileView::updateScrollBars(){
+    int rows = visibleLines();
+    verticalScrollBar()->setRange(0, qMax(0, lines - rows));
+    verticalScrollBar()->setPageStep(rows);
+    horizontalScrollBar()->setRange(0, qMax(0, widest - viewport()->width() / 2));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth() * 4);
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event){
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    measureLines();
+}
+
+//Only the visible lines are decoded
+void LargeFileView::paintEvent(QPaintEvent *){
+    QPainter painter(viewport());
+    QFontMetrics fm = fontMetrics();
+    int height = fm.height();
+    int first = verticalScrollBar()->value();
+    int rows = visibleLines() + 1;
+    int gutter = fm.horizontalAdvance(QString::number(lines)) + 2 * MARGIN;
+    int x = gutter + MARGIN - horizontalScrollBar()->value();
+
+    painter.fillRect(viewport()->rect(), palette().base());
+    painter.fillRect(0, 0, gutter, viewport()->height(), palette().window());
+
+    qint64 offset = data != nullptr ? lineOffset(first) : size;
+    for(int i = 0; i < rows && (offset < size || (offset == size && first + i < lines)); i++){
+        qint64 end = lineEnd(offset);
+        QString raw = lineText(offset, end);
+        QString text = raw;
+        text.replace(QLatin1Char('\t'), QLatin1String("    "));
+        int y = i * height;
+
+        painter.setClipRect(gutter, 0, viewport()->width() - gutter, viewport()->height());
+        if(first + i == selectionLine){
+            int from = fm.horizontalAdvance(raw.left(selectionColumn).replace(QLatin1Char('\t'), QLatin1String("    ")));
+            int width = fm.horizontalAdvance(raw.mid(selectionColumn, selectionLength).replace(QLatin1Char('\t'), QLatin1String("    ")));
+            painter.fillRect(gutter, y, viewport()->width() - gutter, height, palette().alternateBase());
+            if(selectionLength > 0)
+                painter.fillRect(x + from, y, width, height, palette().highlight());
+        }
+
+        painter.setPen(palette().text().color());
+        painter.drawText(x, y + fm.ascent(), text);
+
+        painter.setClipping(false);
+        painter.setPen(palette().placeholderText().color());
+        painter.drawText(QRect(0, y, gutter - MARGIN, height), Qt::AlignRight, QString::number(first + i + 1));
+
+        offset = end + 1;
+    }
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent *event){
+    if(event->matches(QKeySequence::MoveToStartOfDocument))
+        verticalScrollBar()->setValue(0);
+    else if(event->matches(QKeySequence::MoveToEndOfDocument))
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    else
+        QAbstractScrollArea::keyPressEvent(event);
+}
+
+//Show line about a third from the top
+void LargeFileView::gotoLine(int line){
+    select(line, 0, 0);
+}
+
+//Mark part of a line (in characters) and scroll to it
+void LargeFileView::select(int line, int column, int length){
+    selectionLine = qBound(0, line, lines - 1);
+    selectionColumn = column;
+    selectionLength = length;
+
+    int rows = visibleLines();
+    int first = verticalScrollBar()->value();
+    if(selectionLine < first || selectionLine >= first + rows)
+        verticalScrollBar()->setValue(selectionLine - rows / 3);
+
+    //Horizontally, keep the match in view
+    QFontMetrics fm = fontMetrics();
+    qint64 offset = lineOffset(selectionLine);
+    QString raw = lineText(offset, lineEnd(offset));
+    int x = fm.horizontalAdvance(raw.left(column).replace(QLatin1Char('\t'), QLatin1String("    ")));
+    widest = qMax(widest, x);
+    updateScrollBars();
+    int view = viewport()->width() / 2;
+    if(x < horizontalScrollBar()->value() || x > horizontalScrollBar()->value() + view)
+        horizontalScrollBar()->setValue(qMax(0, x - view / 2));
+
+    viewport()->update();
+}
+
+QString LargeFileView::selectedText(){
+    if(selectionLine < 0 || selectionLength <= 0)
+        return QString();
+
+    qint64 offset = lineOffset(selectionLine);
+    return lineText(offset, lineEnd(offset)).mid(selectionColumn, selectionLength);
+}
+
+//Find next (or previous) match after the selection, or from the top of the view. Runs in background,
+//the result comes with found(). Wraps around the file. Case is ignored for ASCII letters only
+void LargeFileView::find(QString pattern, bool regex, bool caseSensitive, bool backward){
+    int generation = searches.fetchAndAddOrdered(1) + 1;
+    if(pattern.isEmpty() || data == nullptr){
+        emit found(false);
+        return;
+    }
+
+    qint64 from;
+    if(selectionLine >= 0){
+        qint64 offset = lineOffset(selectionLine);
+        QString raw = lineText(offset, lineEnd(offset));
+        int column = backward ? selectionColumn : selectionColumn + selectionLength;
+        from = offset + codec->fromUnicode(raw.left(column)).size();
+    } else
+        from = lineOffset(currentLine());
+
+    QByteArray needle = codec->fromUnicode(pattern);
+    QRegularExpression expression(pattern, caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+    if(regex && !expression.isValid()){
+        emit found(false);
+        return;
+    }
+
+    pool->start([this, needle, expression, regex, caseSensitive, backward, from, generation]() {
+        qint64 length = needle.size();
+        qint64 hit = -1;
+        if(!regex){
+            hit = backward ? searchLiteral(0, from, needle, caseSensitive, true, generation)
+                           : searchLiteral(from, size, needle, caseSensitive, false, generation);
+            if(hit < 0)
+                hit = backward ? searchLiteral(from, size, needle, caseSensitive, true, generation)
+                               : searchLiteral(0, qMin(size, from + needle.size() - 1), needle, caseSensitive, false, generation);
+        } else {
+            hit = backward ? searchRegex(0, from, expression, true, generation, &length)
+                           : searchRegex(from, size, expression, false, generation, &length);
+            if(hit < 0)
+                hit = backward ? searchRegex(from, size, expression, true, generation, &length)
+                               : searchRegex(0, from, expression, false, generation, &length);
+        }
+
+        QMetaObject::invokeMethod(this, [this, hit, length, generation]() { searchDone(hit, length, generation); }, Qt::QueuedConnection);
+    });
+}
+
+void LargeFileView::searchDone(qint64 offset, qint64 length, int generation){
+    if(generation != searches.loadAcquire())
+        return;
+
+    if(offset < 0){
+        emit found(false);
+        return;
+    }
+
+    int line = lineAt(offset);
+    qint64 start = startOfLine(data, offset);
+    int column = codec->toUnicode(data + start, (int)(offset - start)).size();
+    select(line, column, codec->toUnicode(data + offset, (int)length).size());
+    emit found(true);
+}
+
+//Worker: first (or last) match that lies in [from, to)
+qint64 LargeFileView::searchLiteral(qint64 from, qint64 to, QByteArray pattern, bool caseSensitive, bool backward, int generation){
+    QByteArray needle = caseSensitive ? pattern : pattern.toLower();
+    QByteArrayMatcher matcher(needle);
+    qint64 overlap = needle.size() - 1;
+
+    if(!backward){
+        for(qint64 pos = from; pos < to; pos += SEARCH_CHUNK){
+            if(searches.loadRelaxed() != generation)
+                return -1;
+
+            int len = (int)qMin(SEARCH_CHUNK + overlap, to - pos);
+            QByteArray chunk = caseSensitive ? QByteArray::fromRawData(data + pos, len) : QByteArray(data + pos, len).toLower();
+            int i = matcher.indexIn(chunk);
+            if(i >= 0)
+                return pos + i;
+        }
+        return -1;
+    }
+
+    for(qint64 end = to; end > from; end -= SEARCH_CHUNK){
+        if(searches.loadRelaxed() != generation)
+            return -1;
+
+        //Matches that start before end and end before to
+        qint64 start = qMax(from, end - SEARCH_CHUNK);
+        int len = (int)(qMin(end + overlap, to) - start);
+        QByteArray chunk = caseSensitive ? QByteArray::fromRawData(data + start, len) : QByteArray(data + start, len).toLower();
+        int i = chunk.lastIndexOf(needle);
+        if(i >= 0)
+            return start + i;
+    }
+    return -1;
+}
+
+//Worker: first (or last) match in [from, to), line by line. Length gets the match length in bytes
+qint64 LargeFileView::searchRegex(qint64 from, qint64 to, const QRegularExpression &expression, bool backward, int generation, qint64 *length){
+    qint64 start = startOfLine(data, backward ? qMax(from, to - 1) : from);
+
+    while(start < to){
+        if(searches.loadRelaxed() != generation)
+            return -1;
+
+        qint64 end = lineEnd(start);
+        QString text = codec->toUnicode(data + start, (int)qMin(end - start, (qint64)INT_MAX));
+        qint64 hit = -1;
+
+        QRegularExpressionMatchIterator it = expression.globalMatch(text);
+        while(it.hasNext()){
+            QRegularExpressionMatch m = it.next();
+            if(m.capturedLength() == 0)
+                continue;
+
+            qint64 offset = start + codec->fromUnicode(text.left(m.capturedStart())).size();
+            qint64 bytes = codec->fromUnicode(m.captured()).size();
+            if(offset < from || offset + bytes > to)
+                continue;
+
+            hit = offset;
+            *length = bytes;
+            if(!backward)
+                break;
+        }
+
+        if(hit >= 0)
+            return hit;
+
+        if(backward){
+            if(start <= from || start == 0)
+                return -1;
+            start = startOfLine(data, start - 1);
+        } else
+            start = end + 1;
+    }
+    return -1;
+}
@@ -0,0 +1,72 @@
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QVector>
+#include <QTextCodec>
+#include <QRegularExpression>
+
+//Read only view of a file that is too big for the editor. The file is memory-mapped and
+//only the visible lines are decoded and painted. A sparse index with the offset of every
+//LINE_STRIDE'th line is built in background; scrolling, goto line and search use it
+class LargeFileView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileView(QWidget *parent = nullptr);
+    ~LargeFileView();
+    bool open(QString fileName);
+    static bool shouldView(qint64 size);
+    int lineCount();
+    bool isIndexing();
+    int currentLine();
+    void gotoLine(int line);
+    void select(int line, int column, int length);
+    void find(QString pattern, bool regex, bool caseSensitive, bool backward = false);
+    QString selectedText();
+
+signals:
+    void lineChanged(int line);
+    void found(bool ok);
+    void indexed(int lines);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+
+private:
+    QFile *file;
+    const char *data;
+    qint64 size;
+    QTextCodec *codec;
+    QThreadPool *pool;
+    QAtomicInt cancelled;
+    QAtomicInt searches; //Generation of the running search, older ones stop
+    QVector<qint64> checkpoints; //Offset of line i * LINE_STRIDE
+    int lines;
+    bool indexing;
+    int selectionLine;
+    int selectionColumn;
+    int selectionLength;
+    int widest;
+    void startIndex();
+    void addCheckpoints(QVector<qint64> batch, int count, bool done);
+    void searchDone(qint64 offset, qint64 length, int generation);
+    qint64 lineOffset(int line);
+    int lineAt(qint64 offset);
+    qint64 lineEnd(qint64 offset);
+    QString lineText(qint64 offset, qint64 end);
+    int visibleLines();
+    void measureLines();
+    void updateScrollBars();
+    void stop();
+    qint64 searchLiteral(qint64 from, qint64 to, QByteArray pattern, bool caseSensitive, bool backward, int generation);
+    qint64 searchRegex(qint64 from, qint64 to, const QRegularExpression &expression, bool backward, int generation, qint64 *length);
+};
+
+#endif // LARGEFILEVIEW_H
@@ -1,12 +1,26 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include <etab.h>
+#include <fileloader.h>
+#include <filesaver.h>
+#include <autosavescheduler.h>
+#include <notestore.h>
+#include <tabregistry.h>
+#include <updatecoalescer.h>
+#include <searchpanel.h>
+#include <outlinepanel.h>
+#include <markdownimporter.h>
+#include <nativeformat.h>
+#include <fileclassifier.h>
 #include <QMessageBox>
+#include <QInputDialog>
 #include <QTextCharFormat>
 #include <QTime>
 #include <QTimer>
 #include <QFileInfo>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
+#include <QRegularExpression>
 #include <QStandardPaths>
 #include <QCloseEvent>
 #include <QTabWidget>
@@ -20,12 +34,60 @@
 #include <QJsonArray>
 #include <qjsondocument.h>
 
+//Number of recently used tabs that are loaded in background after a restore
+#define PREFETCH_TABS 3
+
 MainWindow::MainWindow(QStringList* params, QJsonObject* json, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
 
+    //Lookup of open tabs
+    registry = new TabRegistry(ui->tabs, this);
+
+    //Cursor and format changes update the UI once per frame
+    coalescer = new UpdateCoalescer(this);
+    connect(coalescer, &UpdateCoalescer::statusChanged, this, &MainWindow::applyStatus);
+    connect(coalescer, &UpdateCoalescer::formatChanged, this, &MainWindow::applyFormat);
+    connect(coalescer, &UpdateCoalescer::statisticsChanged, this, &MainWindow::applyStatistics);
+
+    //Find in files, docked below the tabs
+    searchPanel = new SearchPanel(registry, this);
+    addDockWidget(Qt::BottomDockWidgetArea, searchPanel);
+    searchPanel->hide();
+    connect(searchPanel, &SearchPanel::resultActivated, this, &MainWindow::showSearchResult);
+
+    outlinePanel = new OutlinePanel(this);
+    addDockWidget(Qt::LeftDockWidgetArea, outlinePanel);
+    outlinePanel->hide();
+
+    //Files are read and parsed in background
+    loader = new FileLoader(this);
+
+    //Open Markdown files are reloaded when they change on disk
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::watchedFileChanged);
+
+    //Autosaves are written in background
+    saver = new FileSaver(this);
+    connect(saver, &FileSaver::saved, this, &MainWindow::fileSaved);
+
+    //Quick notes are kept here while editing
+    store = new NoteStore();
+
+    //One scheduler for the autosaves of all tabs
+    scheduler = new AutoSaveScheduler(this);
+    connect(scheduler, &AutoSaveScheduler::delayChanged, this, &MainWindow::autoSaveDelayChanged);
+    if(json != nullptr) {
+        if(json->contains("autosaveDelay"))
+            scheduler->setDelay((*json)["autosaveDelay"].toInt());
+        if(json->contains("autosaveBudget"))
+            scheduler->setBudget((qint64)(*json)["autosaveBudget"].toDouble());
+        if(json->contains("autosaveShare"))
+            scheduler->setGuiShare((*json)["autosaveShare"].toDouble());
+    }
+
     QFont font("Consolas", 12);
     ui->tabs->setFont(font);
 
@@ -40,8 +102,13 @@ MainWindow::MainWindow(QStringList* params, QJsonObject* json, QWidget *parent)
     lblStatus->setAlignment(Qt::AlignRight);
     lblStatus->setFont(font);
 
+    this->lblStats = new QLabel();
+    lblStats->setAlignment(Qt::AlignRight);
+    lblStats->setFont(font);
+
     statusBar()->addWidget(lblClock, 1);
-    statusBar()->addWidget(lblStatus, 1);
+    statusBar()->addWidget(lblStats, 2);
+    statusBar()->addWidget(lblStatus, 0);
     statusBar()->setFont(font);
 
     updateTime();
@@ -51,6 +118,7 @@ MainWindow::MainWindow(QStringList* params, QJsonObject* json, QWidget *parent)
 
     setAcceptDrops(true);
     this->donotload = false;
+    this->closingAll = false;
 
     tempfile = QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + QDir::separator() + "easynotepad.json");
 
@@ -63,6 +131,7 @@ MainWindow::~MainWindow()
     if(params != nullptr) {
         params->clear();
     }
+    delete store;
     delete ui;
 }
 
@@ -73,6 +142,7 @@ MainWindow::~MainWindow()
 //Updates time label in statusBar
 void MainWindow::updateTime() {
     lblClock->setText("  \U0001F550 "+QTime::currentTime().toString("HH:mm"));
+    lblClock->setToolTip(scheduler->stats() + "\n" + coalescer->stats());
 }
 
 
@@ -111,15 +181,21 @@ void MainWindow::on_actionOpen_triggered()
     QFileDialog fileDialog(this, tr("Open File(s)..."));
     fileDialog.setAcceptMode(QFileDialog::AcceptOpen);
     fileDialog.setFileMode(QFileDialog::ExistingFiles);
-    fileDialog.setMimeTypeFilters(QStringList()
+    QStringList mimeTypes;
+    mimeTypes
 #if QT_CONFIG(texthtmlparser)
-                                  << "text/html"
+              << "text/html"
 #endif
 #if QT_CONFIG(textmarkdownreader)
-
-                                  << "text/markdown"
+              << "text/markdown"
 #endif
-                                  << "text/plain");
+              << "text/plain";
+    QMimeDatabase &db = FileClassifier::mimeDatabase();
+    QStringList filters;
+    for(const QString &mimeType : mimeTypes)
+        filters << db.mimeTypeForName(mimeType).filterString();
+    filters << NativeFormat::nameFilter();
+    fileDialog.setNameFilters(filters);
     if (fileDialog.exec() != QDialog::Accepted)
         return;
 
@@ -128,8 +204,21 @@ void MainWindow::on_actionOpen_triggered()
     }
 }
 
-void MainWindow::on_actionSave_as_triggered()
+void MainWindow::on_actionSave_as_triggered() { saveAs(); }
+
+//Save current tab as another file. Returns false if it wasn't written
+bool MainWindow::saveAs()
 {
+    ETab *current = registry->current();
+    if(current != nullptr && current->isViewer()){
+        updateMessage("Big files are shown read only, they can't be saved as another file");
+        return false;
+    }
+    if(current != nullptr && current->isLoading()){
+        updateMessage("Wait until the file is loaded to save it");
+        return false;
+    }
+
     QFileDialog fileDialog(this, tr("Save as..."));
     fileDialog.setAcceptMode(QFileDialog::AcceptSave);
     QStringList mimeTypes;
@@ -142,28 +231,65 @@ void MainWindow::on_actionSave_as_triggered()
                            << "text/markdown"
              #endif
              << "text/plain";
-    fileDialog.setMimeTypeFilters(mimeTypes);
-#if QT_CONFIG(textodfwriter)
-    fileDialog.setDefaultSuffix("odt");
-#endif
+    //HTML stays the default, the native format has no mime type and is added by name
+    QMimeDatabase &db = FileClassifier::mimeDatabase();
+    QStringList filters;
+    for(const QString &mimeType : mimeTypes)
+        filters << db.mimeTypeForName(mimeType).filterString();
+    filters << NativeFormat::nameFilter();
+    fileDialog.setNameFilters(filters);
+
+    //File names without suffix get the one of the chosen filter, from the start on
+    auto useSuffix = [&fileDialog](const QString &filter) {
+        QRegularExpressionMatch match = QRegularExpression("\\*\\.(\\w+)").match(filter);
+        if(match.hasMatch())
+            fileDialog.setDefaultSuffix(match.captured(1));
+    };
+    useSuffix(fileDialog.selectedNameFilter());
+    connect(&fileDialog, &QFileDialog::filterSelected, &fileDialog, useSuffix);
 
     if (fileDialog.exec() != QDialog::Accepted)
-        return;
+        return false;
     const QString filename = fileDialog.selectedFiles().first();
 
     //Get selected tab
-    ETab *selected = ui->tabs->findChild<ETab *>(ui->tabs->currentWidget()->objectName());
+    ETab *selected = registry->current();
     if(selected == NULL){
         std::cerr << "Error: selected tab is NULL" << std::endl;
-        return;
+        return false;
     }
 
+    //A restored tab has its content in the store or file only
+    selected->materialize(nullptr);
+
+    QString oldName = selected->getFileName();
+    bool existed = QFileInfo::exists(filename);
     selected->setFileName(filename);
     QFileInfo info(filename);
     QFile f(filename);
     f.open(QIODevice::ReadWrite); //This creates the file
+    f.close();
+    registry->update(selected);
+
+    if(!selected->saveFile(true)){
+        //Keep the quick note or the old file, don't leave an empty new one
+        if(!existed)
+            QFile::remove(filename);
+        selected->setFileName(oldName);
+        registry->update(selected);
+        updateMessage("Failed to save "+info.fileName());
+        return false;
+    }
+
+    //Not a quick note anymore
+    if(!selected->getNotePath().isEmpty()){
+        saver->remove(selected->getNotePath());
+        selected->setNotePath("");
+        registry->update(selected);
+    }
+
     ui->tabs->setTabText(ui->tabs->currentIndex(), info.fileName());
-    changeTab(ACTION::SAVEAS);
+    return true;
 }
 
 //Save file
@@ -251,6 +377,18 @@ void MainWindow::on_actionUse_dark_theme_triggered() { setTheme(THEME::DARK, 1);
 void MainWindow::on_actionUse_blue_theme_triggered() { setTheme(THEME::BLUE, 1); }
 
 void MainWindow::on_actionHyperlink_triggered() { changeTab(ACTION::CREATELINK); }
+void MainWindow::on_actionFind_triggered() { changeTab(ACTION::FIND); }
+void MainWindow::on_actionReplace_triggered() { changeTab(ACTION::REPLACE); }
+
+void MainWindow::on_actionFind_in_files_triggered() {
+    ETab *selected = registry->current();
+    searchPanel->open(selected != nullptr ? selected->getSelection() : QString());
+}
+
+void MainWindow::on_actionOutline_triggered() {
+    outlinePanel->show();
+    outlinePanel->raise();
+}
 
 void MainWindow::on_actionRemeber_opened_files_triggered() {}
 
@@ -283,11 +421,16 @@ void MainWindow::on_actionStay_topmost_triggered()
 void MainWindow::on_actionClose_all_triggered()
 {
     int cnt = ui->tabs->count();
+    closingAll = true; //Don't load restored tabs that become current while closing
     while(ui->tabs->count()>0){
+        int before = ui->tabs->count();
         changeTab(ACTION::CLOSE);
+        if(ui->tabs->count() == before)
+            break; //Cancelled
     }
+    closingAll = false;
 
-    updateMessage(QString("Closed %1 files").arg(cnt));
+    updateMessage(QString("Closed %1 files").arg(cnt - ui->tabs->count()));
 }
 
 
@@ -311,6 +454,7 @@ void MainWindow::dropEvent(QDropEvent *event){
 //Load temp file if exists
 void MainWindow::loadTempFile(){    
     bool restoreAny = false;
+    int notes = 0;
 
     if(settings != nullptr) {
         QJsonObject json = *settings;
@@ -320,7 +464,7 @@ void MainWindow::loadTempFile(){
             QJsonArray files = json["files"].toArray();
             if(files.count() > 0){
                 for (int i = 0; i < files.size(); i++) {
-                    openTab(files[i].toString());
+                    restoreTab(files[i].toString());
                 }
 
                 restoreAny = true;
@@ -341,21 +485,22 @@ void MainWindow::loadTempFile(){
             }
         }
 
-        //Open editors (temp files/quick notes)
+        //Quick notes of an older version, kept in this file
         if(json.contains("editors") && json["editors"].isArray()) {
             QJsonArray arr = json["editors"].toArray();
-            if(arr.size() > 0) {
-                for(int i = 0; i < arr.size(); i++) {
-                    if(arr[i].isObject()) {
-                        QJsonObject o = arr[i].toObject();
-                        openTab(QString("Quick note #%1").arg(i+1));
-                        ETab *selected = ui->tabs->findChild<ETab *>(ui->tabs->currentWidget()->objectName());
-                        selected->setContent(o["content"].toString());
-                    }
+            for(int i = 0; i < arr.size(); i++) {
+                if(arr[i].isObject()) {
+                    QJsonObject o = arr[i].toObject();
+                    restoreTab(QString("Quick note #%1").arg(++notes), o["content"].toString(), store->create());
                 }
+            }
+        }
 
-                restoreAny = true;
-                ui->actionRemember_quick_notes->setChecked(true);
+        //Recently used files, to be loaded first
+        if(json.contains("mru") && json["mru"].isArray()) {
+            QJsonArray arr = json["mru"].toArray();
+            for(int i = 0; i < arr.size(); i++) {
+                recent.append(arr[i].toString());
             }
         }
 
@@ -365,9 +510,46 @@ void MainWindow::loadTempFile(){
         }
     }
 
+    //Quick notes in the recovery store. Notes that were open at exit come first,
+    //then notes of a session that didn't exit cleanly
+    QStringList order;
+    if(settings != nullptr && settings->contains("notes") && (*settings)["notes"].isArray()) {
+        QJsonArray arr = (*settings)["notes"].toArray();
+        for(int i = 0; i < arr.size(); i++) {
+            order.append(arr[i].toString());
+        }
+    }
+
+    for(QString path : store->notes(order)) {
+        restoreTab(QString("Quick note #%1").arg(++notes), QString(), path);
+    }
+
+    if(notes > 0) {
+        restoreAny = true;
+        ui->actionRemember_quick_notes->setChecked(true);
+    }
+
     //If nothing is opened: open new tab
     if(!restoreAny) {
         this->openTab("New file");
+    } else {
+        updateActions();
+        QTimer::singleShot(500, this, &MainWindow::prefetchTabs);
+    }
+}
+
+//Load the most recently used tabs before the user opens them
+void MainWindow::prefetchTabs(){
+    int loaded = 0;
+    for(QString path : recent) {
+        if(loaded >= PREFETCH_TABS)
+            break;
+
+        ETab *tab = registry->byPath(path);
+        if(tab != nullptr && tab->isStub()) {
+            tab->materialize(loader);
+            loaded++;
+        }
     }
 }
 
@@ -380,22 +562,31 @@ void MainWindow::saveTempFile(){
     }
 
     QJsonArray files; //Files to be reloaded from disk
-    QJsonArray editors; //Open editors that will be saved
+    QJsonArray notes; //Ids of open quick notes, their content is in the note store
+    QJsonArray mru; //Recently used files
+
+    QList<ETab*> tabs = registry->all();
+
+    for (ETab* t : registry->mru()) {
+        if(mru.size() >= PREFETCH_TABS)
+            break;
+        if(t->fileExists())
+            mru.append(t->getFileName());
+    }
 
-    QList<ETab*> tabs = ui->tabs->findChildren<ETab*>() ;
     for (ETab* t : tabs) {
         if(t->fileExists()) {
             if(ui->actionRemeber_opened_files->isChecked()) {
                 files.append(t->getFileName());
             }
         } else {
-            if(ui->actionRemember_quick_notes->isChecked() && t->getFileName() != "#About") {
-                QJsonObject editor;
-                editor["content"] = t->getContent();
-
+            if(ui->actionRemember_quick_notes->isChecked() && !t->getNotePath().isEmpty()) {
+                //Only the last edits are written, the rest was autosaved
                 if(t->hasChanges()) {
-                    editors.append(editor);
-                }
+                    t->saveNote();
+                    notes.append(store->idOf(t->getNotePath()));
+                } else
+                    saver->remove(t->getNotePath());
 
                 t->setContent("", false); //Trick to not save file
                 delete t; //Close tab
@@ -403,6 +594,10 @@ void MainWindow::saveTempFile(){
         }
     }
 
+    //Blobs of closed and changed notes
+    saver->flush();
+    store->collect();
+
     QJsonArray resolution;
     if(MainWindow::isMaximized()) {
         resolution.append(MainWindow::normalGeometry().width());
@@ -415,7 +610,8 @@ void MainWindow::saveTempFile(){
     QJsonObject object;
     object["files"] = files;
     object["resolution"] = resolution;
-    object["editors"] = editors;
+    object["notes"] = notes;
+    object["mru"] = mru;
     object["theme"] = (int)this->theme;
 
     QJsonDocument doc(object);
@@ -424,6 +620,52 @@ void MainWindow::saveTempFile(){
     f.close();
 }
 
+//Write snapshot of a tab in background. Takes ownership of the snapshot
+void MainWindow::saveInBackground(QTextDocument *snapshot, QString fileName){
+    saver->save(snapshot, fileName);
+}
+
+//Wait until background saves are on disk
+void MainWindow::waitForSaves(){
+    saver->flush();
+}
+
+//Queue tab for autosave
+void MainWindow::scheduleAutoSave(ETab *tab){
+    scheduler->markDirty(tab);
+}
+
+//Show autosave delay of tab as tooltip
+void MainWindow::autoSaveDelayChanged(ETab *tab, int msec){
+    int i = ui->tabs->indexOf(tab);
+    if(i < 0)
+        return;
+
+    if(msec < 0)
+        ui->tabs->setTabToolTip(i, "Autosave when idle");
+    else
+        ui->tabs->setTabToolTip(i, QString("Autosave every %1 s").arg(msec / 1000));
+}
+
+//Background save is done
+void MainWindow::fileSaved(QString fileName, bool ok, qint64 msec){
+    scheduler->recordSaveLatency(msec);
+
+    //Quick notes are saved silently
+    QFileInfo info(fileName);
+    if(store->contains(fileName)) {
+        if(!ok)
+            updateMessage("Failed to save quick note");
+    } else if(ok)
+        updateMessage(" \U0001F5CE "+info.fileName()+" saved!");
+    else
+        updateMessage("Failed to save "+info.fileName());
+
+    ETab *tab = registry->byPath(fileName);
+    if(tab != nullptr)
+        tab->backgroundSaved(ok);
+}
+
 //Set autosave checked/unchecked
 void MainWindow::updateAutoSave(bool checked){
     ui->actionAutosave->setChecked(checked);
@@ -432,7 +674,7 @@ void MainWindow::updateAutoSave(bool checked){
 //Set font on selected tab
 void MainWindow::setFontOnSelected(const QTextCharFormat &format){
     //Get selected tab
-    ETab *selected = ui->tabs->findChild<ETab *>(ui->tabs->currentWidget()->objectName());
+    ETab *selected = registry->current();
     if(selected == NULL){
         std::cerr << "ERROR: selected tab is NULL" << std::endl;
         return;
@@ -441,19 +683,48 @@ void MainWindow::setFontOnSelected(const QTextCharFormat &format){
     selected->setFontFormat(format);
 }
 
+//Create tab for file name
+ETab* MainWindow::createTab(QString file){
+    ETab *tab = new ETab(this);
+    tab->setObjectName(QString("tab-%1").arg(index++));
+    tab->setFileName(file);
+    registry->add(tab);
+    if(MarkdownImporter::isMarkdown(file) && QFileInfo::exists(file))
+        watcher->addPath(file);
+    return tab;
+}
+
+//A watched file changed, let its tab reload it
+void MainWindow::watchedFileChanged(QString path){
+    ETab *tab = registry->byPath(path);
+    if(tab == nullptr){
+        watcher->removePath(path);
+        return;
+    }
+
+    //Files that are saved by replacing them are not watched anymore
+    if(QFileInfo::exists(path) && !watcher->files().contains(path))
+        watcher->addPath(path);
+
+    tab->fileChanged(loader);
+}
+
 //Open new tab by file name
 void MainWindow::openTab(QString file){
     //Add tab to tabs
-    ETab *tab = new ETab(this);
+    ETab *tab = createTab(file);
     int tabCount = ui->tabs->count();
-    tab->setObjectName(QString("tab-%1").arg(index++));
-    tab->setFileName(file);
 
     QFileInfo fi(file);
     QString title = fi.fileName();
 
     if(fi.exists()){
-        tab->openFile();
+        //Too big to edit, show it read only
+        if(!FileClassifier::classify(file).view || !tab->viewFile())
+            tab->openFile(loader);
+    } else if(!file.startsWith('#')) {
+        tab->setNotePath(store->create());
+        registry->update(tab);
     }
 
     ui->tabs->addTab(tab, title);
@@ -463,6 +734,66 @@ void MainWindow::openTab(QString file){
     updateMessage(" \U0001F5CE "+title+" opened!");
 }
 
+//Add tab from last session without loading it. Content and note path are only used for quick notes
+void MainWindow::restoreTab(QString file, QString content, QString notePath){
+    ETab *tab = createTab(file);
+    tab->setNotePath(notePath);
+    tab->setStub(content);
+    registry->update(tab);
+
+    QFileInfo fi(file);
+    ui->tabs->addTab(tab, fi.fileName());
+}
+
+//Load restored tab when it is opened for the first time
+void MainWindow::on_tabs_currentChanged(int tabIndex){
+    ETab *tab = registry->at(tabIndex);
+    outlinePanel->setTab(tab);
+    if(tab == nullptr)
+        coalescer->setStatistics(QString());
+    if(tab == nullptr || closingAll)
+        return;
+
+    tab->materialize(loader);
+    registry->touch(tab);
+    updateStatistics(tab);
+}
+
+void MainWindow::on_actionGo_to_line_triggered() {
+    ETab *selected = registry->current();
+    if(selected == nullptr)
+        return;
+
+    bool ok;
+    int lines = selected->lineCount();
+    int line = QInputDialog::getInt(this, "Go to line", QString("Line (1 - %1):").arg(lines), 1, 1, lines, 1, &ok);
+    if(ok){
+        selected->gotoLine(line - 1);
+        selected->focus();
+    }
+}
+
+//Go to a find in files result. Files that are not open are opened first
+void MainWindow::showSearchResult(SearchHit hit){
+    ETab *tab = registry->byId(hit.source);
+    if(tab == nullptr && QFileInfo::exists(hit.source)) {
+        tab = registry->byPath(hit.source);
+        if(tab == nullptr) {
+            openTab(hit.source);
+            tab = registry->current();
+        }
+    }
+
+    if(tab == nullptr) {
+        updateMessage("Tab of this result was closed");
+        return;
+    }
+
+    ui->tabs->setCurrentWidget(tab);
+    tab->select(hit);
+    tab->focus();
+}
+
 //Disable/enable actions
 void MainWindow::updateActions() {
     bool enabled = (ui->tabs->count()!=0);
@@ -490,17 +821,36 @@ void MainWindow::toggleMenu(QMenu *menu, bool disable){
 
 //Update bold/italic/underline/strikeout actions when selecting text. Triggered from ETab logic
 void MainWindow::updateActions(const QTextCharFormat &format){
-    ui->actionBold->setChecked(format.font().bold());
-    ui->actionUnderline->setChecked(format.font().underline());
-    ui->actionItalic->setChecked(format.font().italic());
-    ui->actionStrikeout->setChecked(format.font().strikeOut());
+    coalescer->setFormat(format);
+}
+
+void MainWindow::applyFormat(const QTextCharFormat &format){
+    QFont font = format.font();
+    ui->actionBold->setChecked(font.bold());
+    ui->actionUnderline->setChecked(font.underline());
+    ui->actionItalic->setChecked(font.italic());
+    ui->actionStrikeout->setChecked(font.strikeOut());
 }
 
 //Update status label. Triggered from ETab logic
 void MainWindow::updateStatusLabel(int line, int col){
+    coalescer->setStatus(line, col);
+}
+
+void MainWindow::applyStatus(int line, int col){
     lblStatus->setText(QString("ln: %1 col: %2 ").arg(line).arg(col));
 }
 
+//Update word/line counts in the status bar, if the tab is shown. Triggered from ETab logic
+void MainWindow::updateStatistics(ETab *tab){
+    if(tab == registry->current())
+        coalescer->setStatistics(tab->statistics());
+}
+
+void MainWindow::applyStatistics(QString text){
+    lblStats->setText(text);
+}
+
 //Show message in statusBar
 void MainWindow::updateMessage(QString message){
     ui->statusbar->showMessage(message, 3000);
@@ -509,7 +859,7 @@ void MainWindow::updateMessage(QString message){
 
 //Execute actions on selected tab
 void MainWindow::changeTab(ACTION action, int argument){
-    ETab *selected = ui->tabs->findChild<ETab *>(ui->tabs->currentWidget()->objectName());
+    ETab *selected = registry->current();
     if(selected == NULL){
         std::cerr << "ERROR: selected tab is NULL" << std::endl;
         return;
@@ -530,8 +880,9 @@ void MainWindow::changeTab(ACTION action, int argument){
         case ACTION::SAVE:
         {
             if(!info.exists())
-                on_actionSave_as_triggered();
-            selected->saveFile();
+                saveAs();
+            else
+                selected->saveFile();
         }
         break;
         case ACTION::SAVEAS:
@@ -556,7 +907,8 @@ void MainWindow::changeTab(ACTION action, int argument){
             {
                 QMessageBox::StandardButton res = QMessageBox::question(this, "Save file?", QString("Do you want to save %1?").arg(info.fileName()), QMessageBox::Save|QMessageBox::Discard|QMessageBox::Cancel);
                 if(res == QMessageBox::Save){
-                    on_actionSave_as_triggered();
+                    if(!saveAs())
+                        return;
                 } else if(res == QMessageBox::Cancel) {
                     return;
                 }
@@ -564,6 +916,10 @@ void MainWindow::changeTab(ACTION action, int argument){
             else
                 selected->saveFile();
 
+            //Closed quick note is gone, also after a crash
+            if(!selected->getNotePath().isEmpty())
+                saver->remove(selected->getNotePath());
+
             delete selected;
             //ui->tabs->removeTab(ui->tabs->currentIndex());
             updateActions();
@@ -585,6 +941,9 @@ void MainWindow::changeTab(ACTION action, int argument){
         case ACTION::CREATELINK:
             selected->createLink();
         break;
+        case ACTION::FIND: case ACTION::REPLACE:
+            selected->showFind(action == ACTION::REPLACE);
+        break;
     }
 }
 
@@ -619,7 +978,7 @@ void MainWindow::on_actionAbout_triggered()
 {
     openTab("#About");
     QString hardCodedAboutPage = "<h1>EasyNotepad++</h1><p>EasyNotepad++ is an richtext editor for Windows and Linux. It supports HTML, Markdown, and plain text files. It is also able to export a file to an ODT-file. It is made with QT and C++</p><h1>Licence</h1><p>EasyNotepad is licenced under the MIT-licence.</p><br/><h4>&rarr;&nbsp;More info, see <a href=\"https://github.com/maurictg/EasyNotepadPlusPlus\">https://github.com/maurictg/EasyNotepadPlusPlus</a></h4>";
-    ETab *selected = ui->tabs->findChild<ETab *>(ui->tabs->currentWidget()->objectName());
+    ETab *selected = registry->current();
     selected->setContent(hardCodedAboutPage, false);
 }
 
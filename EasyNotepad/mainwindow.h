@@ -6,7 +6,19 @@
 #include <QLabel>
 #include <QMenu>
 #include <iostream>
+#include <filesearch.h>
 
+class FileLoader;
+class FileSaver;
+class AutoSaveScheduler;
+class NoteStore;
+class TabRegistry;
+class UpdateCoalescer;
+class SearchPanel;
+class OutlinePanel;
+class QTextDocument;
+class QFileSystemWatcher;
+class ETab;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -20,15 +32,19 @@ public:
     MainWindow(QStringList* params, QJsonObject *json = nullptr, QWidget *parent = nullptr);
     ~MainWindow();
     void updateStatusLabel(int line, int col);
+    void updateStatistics(ETab *tab);
     void updateActions(const QTextCharFormat &format);
     void updateMessage(QString message);
     void updateAutoSave(bool checked);
+    void saveInBackground(QTextDocument *snapshot, QString fileName);
+    void waitForSaves();
+    void scheduleAutoSave(ETab *tab);
     enum ACTION {
         CHANGEFONTSIZE, CHANGEFONT, CHANGECOLOR, CLOSE, SAVE, SAVEAS, DELETE, SETAUTOSAVE,
         SETHNORMAL, SETH1, SETH2, SETH3, SETH4, SETH5, SETH6,
         LISTDISK, LISTCIRCLE, LISTSQUARE, LISTUNCHECKED, LISTCHECKED, LISTDECIMAL,
         LISTALPHALOWER, LISTALPHAUPPER, LISTROMANLOWER, LISTROMANUPPER,
-        ALIGNLEFT, ALIGNCENTER, ALIGNRIGHT, ALIGNJUSTIFY, CREATELINK
+        ALIGNLEFT, ALIGNCENTER, ALIGNRIGHT, ALIGNJUSTIFY, CREATELINK, FIND, REPLACE
     };
     enum THEME {
         DEFAULT, LIGHT, DARK, BLUE
@@ -83,21 +99,50 @@ private slots:
     void on_actionUse_dark_theme_triggered();
     void on_actionUse_blue_theme_triggered();
     void on_actionHyperlink_triggered();
+    void on_actionFind_triggered();
+    void on_actionReplace_triggered();
+    void on_actionFind_in_files_triggered();
+    void on_actionGo_to_line_triggered();
+    void on_actionOutline_triggered();
+    void on_tabs_currentChanged(int tabIndex);
+    void prefetchTabs();
+    void fileSaved(QString fileName, bool ok, qint64 msec);
+    void autoSaveDelayChanged(ETab *tab, int msec);
+    void applyStatus(int line, int col);
+    void applyFormat(const QTextCharFormat &format);
+    void applyStatistics(QString text);
+    void showSearchResult(SearchHit hit);
+    void watchedFileChanged(QString path);
 
 private:
     Ui::MainWindow *ui;
     QLabel *lblStatus;
+    QLabel *lblStats;
     QLabel *lblClock;
     QString tempfile;
     QJsonObject *settings;
     QStringList *params;
+    FileLoader *loader;
+    FileSaver *saver;
+    AutoSaveScheduler *scheduler;
+    NoteStore *store;
+    TabRegistry *registry;
+    UpdateCoalescer *coalescer;
+    SearchPanel *searchPanel;
+    OutlinePanel *outlinePanel;
+    QFileSystemWatcher *watcher;
+    QStringList recent;
     THEME theme;
     void setFontOnSelected(const QTextCharFormat &format);
     void openTab(QString title);
+    void restoreTab(QString file, QString content = QString(), QString notePath = QString());
+    ETab* createTab(QString file);
+    bool saveAs();
     void updateActions();
     void changeTab(ACTION action, int argument = 0);
     int index;
     bool donotload;
+    bool closingAll;
     void loadTempFile();
     void saveTempFile();
     void setTheme(THEME theme, bool showMessage = false);
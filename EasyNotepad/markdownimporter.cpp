@@ -0,0 +1,277 @@
+#include "markdownimporter.h"
+
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QThreadPool>
+
+#include <fileclassifier.h>
+
+//Chunks are at least this many characters, smaller files are one chunk
+#define MIN_CHUNK (32 * 1024)
+//Chunks end at the next block start after this many characters
+#define MAX_CHUNK (512 * 1024)
+//About one in this many block starts ends a chunk, chosen by a hash of the line
+#define CHUNK_SPREAD 8
+
+//Chunks are parsed on a pool of their own, so a reload in the GUI thread doesn't wait
+//behind images or other work on the global pool
+static QThreadPool *parsePool(){
+    static QThreadPool pool;
+    return &pool;
+}
+
+bool MarkdownImporter::isMarkdown(QString fileName){
+    return FileClassifier::mimeDatabase().mimeTypeForFile(fileName, QMimeDatabase::MatchExtension).name() == QLatin1String("text/markdown");
+}
+
+//Can a chunk start with this line, without changing how the line before it is parsed.
+//List items may belong to the list before the blank line, HTML blocks may contain blank lines
+static bool startsBlock(const QStringRef &line){
+    QChar c = line.at(0);
+    if(c == QLatin1Char('<'))
+        return false;
+
+    if(c == QLatin1Char('-') || c == QLatin1Char('*') || c == QLatin1Char('+'))
+        return line.size() > 1 && !line.at(1).isSpace();
+
+    int digits = 0;
+    while(digits < line.size() && digits < 10 && line.at(digits).isDigit())
+        digits++;
+    if(digits > 0 && digits < line.size() && (line.at(digits) == QLatin1Char('.') || line.at(digits) == QLatin1Char(')')))
+        return false;
+
+    return true;
+}
+
+//End marker of an HTML block that may contain blank lines (raw text tags, comments,
+//processing instructions, declarations, CDATA), or empty if line starts none
+static QString htmlBlockEnd(const QStringRef &line){
+    static const QRegularExpression raw(QStringLiteral("^<(script|pre|style|textarea)(\\s|>|$)"), QRegularExpression::CaseInsensitiveOption);
+
+    if(line.startsWith(QLatin1String("<!--")))
+        return QStringLiteral("-->");
+    if(line.startsWith(QLatin1String("<?")))
+        return QStringLiteral("?>");
+    if(line.startsWith(QLatin1String("<![CDATA[")))
+        return QStringLiteral("]]>");
+    if(line.startsWith(QLatin1String("<!")) && line.size() > 2 && line.at(2).isLetter())
+        return QStringLiteral(">");
+
+    QRegularExpressionMatch match = raw.match(line);
+    if(match.hasMatch())
+        return QLatin1String("</") + match.captured(1).toLower() + QLatin1Char('>');
+    return QString();
+}
+
+//Top level block boundaries that are far enough apart. Link reference definitions apply
+//to the whole file, they are collected so every chunk can get them
+QVector<MarkdownImporter::Range> MarkdownImporter::split(const QString &text, QString *definitions){
+    static const QRegularExpression definition(QStringLiteral("^\\[[^\\]]+\\]:"));
+
+    QVector<Range> ranges;
+    int chunkStart = 0;
+    bool fence = false;
+    QChar fenceChar;
+    int fenceLength = 0;
+    QString htmlEnd; //Of the HTML block the line is in
+    bool previousBlank = true;
+
+    int pos = 0;
+    while(pos < text.size()){
+        int end = text.indexOf(QLatin1Char('\n'), pos);
+        if(end < 0)
+            end = text.size();
+
+        QStringRef line = text.midRef(pos, end - pos);
+        int indent = 0;
+        while(indent < line.size() && line.at(indent) == QLatin1Char(' '))
+            indent++;
+        if(indent < line.size() && line.at(indent) == QLatin1Char('\t'))
+            indent += 4;
+        QStringRef rest = line.mid(qMin(indent, line.size())).trimmed();
+        bool blank = rest.isEmpty();
+
+        if(fence){
+            //Closing fence: the fence char only, at least as many as it was opened with
+            if(indent < 4 && rest.size() >= fenceLength && rest.count(fenceChar) == rest.size())
+                fence = false;
+            previousBlank = false;
+        } else if(!htmlEnd.isEmpty()){
+            if(line.contains(htmlEnd, Qt::CaseInsensitive))
+                htmlEnd.clear();
+            previousBlank = false;
+        } else {
+            int length = pos - chunkStart;
+            if(!blank && previousBlank && indent == 0 && length >= MIN_CHUNK && startsBlock(line)
+                    && (length >= MAX_CHUNK || qHash(line) % CHUNK_SPREAD == 0)){
+                ranges.append({chunkStart, length});
+                chunkStart = pos;
+            }
+
+            if(indent < 4 && (rest.startsWith(QLatin1String("```")) || rest.startsWith(QLatin1String("~~~")))){
+                fence = true;
+                fenceChar = rest.at(0);
+                fenceLength = 0;
+                while(fenceLength < rest.size() && rest.at(fenceLength) == fenceChar)
+                    fenceLength++;
+            } else if(indent < 4 && rest.startsWith(QLatin1Char('<'))){
+                //Like fences, they run until their end marker, blank lines or not
+                htmlEnd = htmlBlockEnd(rest);
+                if(!htmlEnd.isEmpty() && rest.mid(2).contains(htmlEnd, Qt::CaseInsensitive))
+                    htmlEnd.clear();
+            } else if(indent < 4 && rest.startsWith(QLatin1Char('[')) && definition.match(rest).hasMatch())
+                definitions->append(rest.toString() + QLatin1Char('\n'));
+
+            previousBlank = blank;
+        }
+
+        pos = end + 1;
+    }
+
+    ranges.append({chunkStart, text.size() - chunkStart});
+    return ranges;
+}
+
+//Parse chunks on the parse pool. Each one is parsed after a dummy paragraph, so the
+//fragment starts with the separator of its first block and keeps that block's format.
+//With first set, the first chunk is parsed into it by the calling thread meanwhile
+QVector<QTextDocumentFragment> MarkdownImporter::parse(const QString &text, const QVector<Range> &ranges, const QString &definitions, int *blocks, QTextDocument *first){
+    QVector<QTextDocumentFragment> fragments(ranges.size());
+    QTextDocumentFragment *out = fragments.data();
+    QSemaphore done;
+    int begin = first != nullptr ? 1 : 0;
+
+    for(int i = begin; i < ranges.size(); i++){
+        QString chunk = QStringLiteral("x\n\n");
+        chunk += text.midRef(ranges[i].start, ranges[i].length);
+        chunk += QLatin1String("\n\n");
+        chunk += definitions;
+        parsePool()->start([chunk, out, blocks, i, &done]() {
+            QTextDocument doc;
+            doc.setMarkdown(chunk);
+            blocks[i] = doc.blockCount() - 1;
+
+            QTextCursor cursor(&doc);
+            cursor.setPosition(doc.begin().length() - 1);
+            cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+            if(cursor.hasSelection())
+                out[i] = QTextDocumentFragment(cursor);
+            done.release();
+        });
+    }
+
+    if(first != nullptr){
+        first->setMarkdown(text.left(ranges[0].length) + QLatin1String("\n\n") + definitions);
+        blocks[0] = first->blockCount();
+    }
+
+    done.acquire(ranges.size() - begin);
+    return fragments;
+}
+
+//Set document to the Markdown text. The first chunk is parsed into the document, the others are appended
+void MarkdownImporter::import(QTextDocument *document, const QString &text, Index *index){
+    QString definitions;
+    QVector<Range> ranges = split(text, &definitions);
+    QVector<int> blocks(ranges.size());
+    QVector<QTextDocumentFragment> fragments = parse(text, ranges, definitions, blocks.data(), document);
+
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    for(int i = 1; i < fragments.size(); i++){
+        if(!fragments[i].isEmpty())
+            cursor.insertFragment(fragments[i]);
+    }
+
+    index->chunks.clear();
+    index->definitions = qHash(definitions);
+    index->revision = -1;
+    for(int i = 0; i < ranges.size(); i++){
+        Chunk chunk;
+        chunk.hash = qHash(text.midRef(ranges[i].start, ranges[i].length));
+        chunk.length = ranges[i].length;
+        chunk.blocks = blocks[i];
+        index->chunks.append(chunk);
+    }
+}
+
+//Text of an imported file changed: replace only the blocks of the chunks that differ.
+//Returns false if the document has to be imported again
+bool MarkdownImporter::update(QTextDocument *document, Index *index, const QString &text){
+    QString definitions;
+    QVector<Range> ranges = split(text, &definitions);
+    if(index->chunks.isEmpty() || qHash(definitions) != index->definitions)
+        return false;
+
+    int total = 0;
+    for(const Chunk &chunk : index->chunks)
+        total += chunk.blocks;
+    if(total != document->blockCount())
+        return false;
+
+    QVector<Chunk> chunks(ranges.size());
+    for(int i = 0; i < ranges.size(); i++){
+        chunks[i].hash = qHash(text.midRef(ranges[i].start, ranges[i].length));
+        chunks[i].length = ranges[i].length;
+    }
+
+    //Same chunks at start and end
+    const QVector<Chunk> &old = index->chunks;
+    auto same = [&](int a, int b) { return old[a].hash == chunks[b].hash && old[a].length == chunks[b].length; };
+    int prefix = 0;
+    while(prefix < old.size() && prefix < chunks.size() && same(prefix, prefix))
+        prefix++;
+    if(prefix == old.size() && prefix == chunks.size())
+        return true;
+
+    int suffix = 0;
+    while(suffix < old.size() - prefix && suffix < chunks.size() - prefix && same(old.size() - 1 - suffix, chunks.size() - 1 - suffix))
+        suffix++;
+
+    //The first chunk is the start of the document itself, it has no separator to insert after
+    if(prefix == 0)
+        return false;
+
+    int first = 0;
+    for(int i = 0; i < prefix; i++)
+        first += old[i].blocks;
+    int removed = 0;
+    for(int i = prefix; i < old.size() - suffix; i++)
+        removed += old[i].blocks;
+
+    QVector<Range> changed = ranges.mid(prefix, ranges.size() - suffix - prefix);
+    QVector<int> blocks(changed.size());
+    QVector<QTextDocumentFragment> fragments = parse(text, changed, definitions, blocks.data(), nullptr);
+
+    //From the end of the last block that stays to the end of the last block that goes
+    QTextBlock before = document->findBlockByNumber(first - 1);
+    int from = before.position() + before.length() - 1;
+    int to = from;
+    if(removed > 0){
+        QTextBlock last = document->findBlockByNumber(first + removed - 1);
+        to = last.position() + last.length() - 1;
+    }
+
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.setPosition(from);
+    cursor.setPosition(to, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    for(const QTextDocumentFragment &fragment : fragments){
+        if(!fragment.isEmpty())
+            cursor.insertFragment(fragment);
+    }
+    cursor.endEditBlock();
+
+    for(int i = 0; i < changed.size(); i++)
+        chunks[prefix + i].blocks = blocks[i];
+    for(int i = 0; i < prefix; i++)
+        chunks[i].blocks = old[i].blocks;
+    for(int i = 0; i < suffix; i++)
+        chunks[chunks.size() - 1 - i].blocks = old[old.size() - 1 - i].blocks;
+
+    index->chunks = chunks;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef MARKDOWNIMPORTER_H
+#define MARKDOWNIMPORTER_H
+
+#include <QString>
+#include <QVector>
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+
+//Imports Markdown in chunks that are parsed in parallel. Chunks only end where a new
+//top level block starts, never in a list, quote, code fence or HTML block, so each one
+//parses the same as it would in the whole file. Chunk ends depend on the text around
+//them only, so after a change of the file the other chunks stay the same and are not
+//parsed again
+class MarkdownImporter
+{
+public:
+    struct Chunk {
+        uint hash = 0;
+        int length = 0;
+        int blocks = 0; //In the document
+    };
+
+    //Chunks of the imported text. Only valid while the document is not edited
+    struct Index {
+        QVector<Chunk> chunks;
+        uint definitions = 0; //Hash of the link reference definitions, every chunk gets them
+        int revision = -1; //Of the document, once it is in the editor
+    };
+
+    static bool isMarkdown(QString fileName);
+    static void import(QTextDocument *document, const QString &text, Index *index);
+    static bool update(QTextDocument *document, Index *index, const QString &text);
+
+private:
+    struct Range {
+        int start;
+        int length;
+    };
+
+    static QVector<Range> split(const QString &text, QString *definitions);
+    static QVector<QTextDocumentFragment> parse(const QString &text, const QVector<Range> &ranges, const QString &definitions, int *blocks, QTextDocument *first);
+};
+
+#endif // MARKDOWNIMPORTER_H
@@ -0,0 +1,235 @@
+#include "nativeformat.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextFrame>
+#include <QTextList>
+#include <QtEndian>
+
+#define VERSION 1
+#define FLAG_HTML 1
+#define HEADER_SIZE 24
+#define BLOCK_SIZE 16
+#define FRAGMENT_SIZE 8
+//Characters of text that are encoded before they are written
+#define PART_SIZE (64 * 1024)
+
+static const char MAGIC[] = "ENPD";
+const QByteArray NativeFormat::SUFFIX = QByteArrayLiteral("enp");
+
+static void append(QByteArray &out, qint32 value){
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+static qint32 at(const uchar *data){
+    return qFromLittleEndian<qint32>(data);
+}
+
+//Filter for file dialogs
+QString NativeFormat::nameFilter(){
+    return QString("EasyNotepad document (*.%1)").arg(QString(SUFFIX));
+}
+
+bool NativeFormat::isNative(const QByteArray &head){
+    return head.startsWith(MAGIC);
+}
+
+bool NativeFormat::write(QTextDocument *document, QIODevice *device){
+    //Tables are frames with cells, those are left to HTML
+    bool html = !document->rootFrame()->childFrames().isEmpty();
+
+    //Indexes into the format table of the document, text is written after them
+    QByteArray blocks;
+    QByteArray fragments;
+    QHash<QTextList*, qint32> lists;
+    QVector<qint32> listFormats;
+    qint32 blockCount = 0;
+    qint32 fragmentCount = 0;
+    qint32 textLength = 0;
+    for(QTextBlock block = document->begin(); !html && block.isValid(); block = block.next()){
+        qint32 list = -1;
+        if(QTextList *textList = block.textList()){
+            list = lists.value(textList, listFormats.size());
+            if(list == listFormats.size()){
+                lists.insert(textList, list);
+                listFormats.append(textList->formatIndex());
+            }
+        }
+
+        qint32 count = 0;
+        for(QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it){
+            QTextFragment fragment = it.fragment();
+            append(fragments, fragment.length());
+            append(fragments, fragment.charFormatIndex());
+            count++;
+        }
+
+        append(blocks, block.blockFormatIndex());
+        append(blocks, block.charFormatIndex());
+        append(blocks, list);
+        append(blocks, count);
+        blockCount++;
+        fragmentCount += count;
+        textLength += block.length() - 1;
+    }
+
+    QByteArray header(MAGIC, 4);
+    append(header, VERSION);
+    append(header, html ? FLAG_HTML : 0);
+    append(header, blockCount);
+    append(header, fragmentCount);
+    append(header, textLength);
+    if(device->write(header) != header.size() || device->write(blocks) != blocks.size() || device->write(fragments) != fragments.size())
+        return false;
+    blocks.clear();
+    fragments.clear();
+
+    QByteArray buffer;
+    for(QTextBlock block = document->begin(); !html && block.isValid(); block = block.next()){
+        QString text = block.text();
+        int size = buffer.size();
+        buffer.resize(size + text.size() * 2);
+        qToLittleEndian<quint16>(text.utf16(), text.size(), buffer.data() + size);
+
+        if(buffer.size() >= PART_SIZE * 2 || !block.next().isValid()){
+            if(device->write(buffer) != buffer.size())
+                return false;
+            buffer.clear();
+        }
+    }
+
+    QByteArray formats;
+    QDataStream stream(&formats, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << document->metaInformation(QTextDocument::DocumentTitle);
+    if(html)
+        stream << document->toHtml("UTF-8");
+    else
+        stream << QTextFormat(document->rootFrame()->frameFormat()) << document->allFormats() << listFormats;
+
+    return device->write(formats) == formats.size();
+}
+
+//Map the file and build the document from it. Files that can't be mapped are read
+bool NativeFormat::read(QFile *file, QTextDocument *document){
+    document->setUndoRedoEnabled(false);
+    bool ok;
+    qint64 size = file->size();
+    uchar *data = file->map(0, size);
+    if(data != nullptr){
+        ok = build(data, size, document);
+        file->unmap(data);
+    } else {
+        file->seek(0);
+        QByteArray bytes = file->readAll();
+        ok = build(reinterpret_cast<const uchar*>(bytes.constData()), bytes.size(), document);
+    }
+    document->setUndoRedoEnabled(true);
+    return ok;
+}
+
+bool NativeFormat::build(const uchar *data, qint64 size, QTextDocument *document){
+    if(size < HEADER_SIZE || !isNative(QByteArray::fromRawData(reinterpret_cast<const char*>(data), 4)))
+        return false;
+
+    //Newer versions may store things this one doesn't know
+    if(at(data + 4) > VERSION)
+        return false;
+
+    qint32 flags = at(data + 8);
+    qint32 blockCount = at(data + 12);
+    qint32 fragmentCount = at(data + 16);
+    qint32 textLength = at(data + 20);
+    if(blockCount < 0 || fragmentCount < 0 || textLength < 0)
+        return false;
+
+    qint64 fragmentsAt = HEADER_SIZE + qint64(blockCount) * BLOCK_SIZE;
+    qint64 textAt = fragmentsAt + qint64(fragmentCount) * FRAGMENT_SIZE;
+    qint64 formatsAt = textAt + qint64(textLength) * 2;
+    if(formatsAt > size)
+        return false;
+
+    QDataStream stream(QByteArray::fromRawData(reinterpret_cast<const char*>(data + formatsAt), size - formatsAt));
+    stream.setVersion(QDataStream::Qt_5_15);
+    QString title;
+    stream >> title;
+
+    //The title is set last, setHtml and clear reset it
+    if(flags & FLAG_HTML){
+        QString html;
+        stream >> html;
+        if(stream.status() != QDataStream::Ok)
+            return false;
+        document->setHtml(html);
+        document->setMetaInformation(QTextDocument::DocumentTitle, title);
+        return true;
+    }
+
+    QTextFormat root;
+    QVector<QTextFormat> formats;
+    QVector<qint32> listFormats;
+    stream >> root >> formats >> listFormats;
+    if(stream.status() != QDataStream::Ok)
+        return false;
+
+    //Object indexes are of the lists and frames of the saved document
+    for(QTextFormat &format : formats)
+        format.setObjectIndex(-1);
+    auto formatAt = [&formats](qint32 i) { return i >= 0 && i < formats.size() ? formats[i] : QTextFormat(); };
+
+    QString text(textLength, Qt::Uninitialized);
+    qFromLittleEndian<quint16>(data + textAt, textLength, text.data());
+
+    document->clear();
+    document->rootFrame()->setFrameFormat(root.toFrameFormat());
+    QVector<QTextList*> lists(listFormats.size(), nullptr);
+    QTextCursor cursor(document);
+    const uchar *block = data + HEADER_SIZE;
+    const uchar *fragment = data + fragmentsAt;
+    qint32 fragmentsLeft = fragmentCount;
+    qint32 position = 0;
+    for(qint32 i = 0; i < blockCount; i++, block += BLOCK_SIZE){
+        QTextBlockFormat blockFormat = formatAt(at(block)).toBlockFormat();
+        QTextCharFormat charFormat = formatAt(at(block + 4)).toCharFormat();
+        qint32 list = at(block + 8);
+        qint32 count = at(block + 12);
+        if(count < 0 || count > fragmentsLeft)
+            return false;
+        fragmentsLeft -= count;
+
+        if(i == 0){
+            cursor.setBlockFormat(blockFormat);
+            cursor.setBlockCharFormat(charFormat);
+        } else
+            cursor.insertBlock(blockFormat, charFormat);
+
+        if(list >= 0 && list < lists.size()){
+            if(lists[list] == nullptr)
+                lists[list] = cursor.createList(formatAt(listFormats[list]).toListFormat());
+            else
+                lists[list]->add(cursor.block());
+        }
+
+        for(; count > 0; count--, fragment += FRAGMENT_SIZE){
+            qint32 length = at(fragment);
+            QTextCharFormat format = formatAt(at(fragment + 4)).toCharFormat();
+            if(length < 0 || length > textLength - position)
+                return false;
+
+            //Each image is one object replacement character
+            if(format.isImageFormat()){
+                for(qint32 j = 0; j < length; j++)
+                    cursor.insertImage(format.toImageFormat());
+            } else
+                cursor.insertText(text.mid(position, length), format);
+            position += length;
+        }
+    }
+
+    document->setMetaInformation(QTextDocument::DocumentTitle, title);
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef NATIVEFORMAT_H
+#define NATIVEFORMAT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QTextDocument>
+
+//Binary document format (.enp). Stores the text, the format table of the document and
+//per block the indexes into it, so loading builds the document without parsing HTML.
+//All numbers are little endian. Layout:
+//  header     magic "ENPD", version, flags, block count, fragment count, text length (6 x uint32)
+//  blocks     block format, block char format, list, fragment count (4 x int32 each)
+//  fragments  length, char format (2 x int32 each)
+//  text       UTF-16 text of all blocks, without separators
+//  formats    QDataStream: title, root frame format, format table, list formats
+//Documents with tables store the title and then HTML in the formats part instead (HTML flag)
+class NativeFormat
+{
+public:
+    static const QByteArray SUFFIX;
+
+    static QString nameFilter();
+    static bool isNative(const QByteArray &head);
+    static bool write(QTextDocument *document, QIODevice *device);
+    static bool read(QFile *file, QTextDocument *document);
+
+private:
+    static bool build(const uchar *data, qint64 size, QTextDocument *document);
+};
+
+#endif // NATIVEFORMAT_H
@@ -0,0 +1,149 @@
+#include "notestore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QUuid>
+#include <iostream>
+
+//Folder of the blobs, next to the notes
+#define BLOBS "blobs"
+
+const QString NoteStore::SUFFIX = QStringLiteral("note");
+
+NoteStore::NoteStore()
+{
+    dir = directory();
+    QDir().mkpath(dir + QDir::separator() + BLOBS);
+    migrate();
+}
+
+//Path for a new note. The file is created on the first save
+QString NoteStore::create(){
+    return pathOf(QUuid::createUuid().toString(QUuid::WithoutBraces));
+}
+
+QString NoteStore::idOf(QString path) {
+    return QFileInfo(path).completeBaseName();
+}
+
+QString NoteStore::pathOf(QString id) {
+    return dir + QDir::separator() + id + "." + SUFFIX;
+}
+
+QString NoteStore::directory() {
+    return QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QDir::separator() + "notes");
+}
+
+bool NoteStore::contains(QString path) {
+    return isNote(path);
+}
+
+//Notes are told by where they are, files of the user may have the same suffix
+bool NoteStore::isNote(QString path) {
+    QFileInfo info(path);
+    return info.suffix() == SUFFIX && info.absolutePath() == QFileInfo(directory()).absoluteFilePath();
+}
+
+//All stored notes: the given ids first, then the rest (e.g. after a crash) from old to new
+QStringList NoteStore::notes(QStringList order){
+    QStringList result;
+    for(QString id : order) {
+        QString path = pathOf(id);
+        if(QFile::exists(path))
+            result.append(path);
+    }
+
+    QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*." + SUFFIX, QDir::Files, QDir::Time | QDir::Reversed);
+    for(QFileInfo info : files) {
+        if(!result.contains(info.absoluteFilePath()))
+            result.append(info.absoluteFilePath());
+    }
+
+    return result;
+}
+
+//Notes of older versions are HTML files, move them into the blobs once
+void NoteStore::migrate(){
+    QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.html", QDir::Files);
+    for(QFileInfo info : files) {
+        QFile f(info.absoluteFilePath());
+        if(!f.open(QIODevice::ReadOnly))
+            continue;
+
+        QString html = QString::fromUtf8(f.readAll());
+        f.close();
+        if(write(pathOf(info.completeBaseName()), html))
+            f.remove();
+    }
+}
+
+//Delete blobs no note refers to anymore. Call when no saves are pending
+void NoteStore::collect(){
+    QSet<QString> used;
+    QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*." + SUFFIX, QDir::Files);
+    for(QFileInfo info : files) {
+        QFile f(info.absoluteFilePath());
+        if(f.open(QIODevice::ReadOnly))
+            used.insert(QString::fromLatin1(f.readAll().trimmed()));
+    }
+
+    QDir blobs(dir + QDir::separator() + BLOBS);
+    for(QString name : blobs.entryList(QDir::Files)) {
+        if(!used.contains(name))
+            blobs.remove(name);
+    }
+}
+
+QString NoteStore::blobOf(QString path, QByteArray hash){
+    return QFileInfo(path).absolutePath() + QDir::separator() + BLOBS + QDir::separator() + QString::fromLatin1(hash);
+}
+
+QString NoteStore::read(QString path){
+    QFile f(path);
+    if(!f.open(QIODevice::ReadOnly)){
+        std::cerr << "ERROR: Failed to read quick note" << std::endl;
+        return QString();
+    }
+
+    QFile blob(blobOf(path, f.readAll().trimmed()));
+    if(!blob.open(QIODevice::ReadOnly)){
+        std::cerr << "ERROR: Failed to read quick note" << std::endl;
+        return QString();
+    }
+
+    return QString::fromUtf8(qUncompress(blob.readAll()));
+}
+
+//Write the blob if there is none with this content yet, then point the note to it.
+//Both are written at once, the old version stays until the new one is complete
+bool NoteStore::write(QString path, QString html){
+    QByteArray data = html.toUtf8();
+    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+
+    QString blobPath = blobOf(path, hash);
+    if(!QFile::exists(blobPath)){
+        QSaveFile blob(blobPath);
+        if(!blob.open(QIODevice::WriteOnly)){
+            std::cerr << "ERROR: Failed to write quick note" << std::endl;
+            return false;
+        }
+
+        blob.write(qCompress(data));
+        if(!blob.commit())
+            return false;
+    }
+
+    QSaveFile f(path);
+    if(!f.open(QIODevice::WriteOnly)){
+        std::cerr << "ERROR: Failed to write quick note" << std::endl;
+        return false;
+    }
+
+    f.write(hash);
+    return f.commit();
+}
@@ -0,0 +1,34 @@
+#ifndef NOTESTORE_H
+#define NOTESTORE_H
+
+#include <QString>
+#include <QStringList>
+
+//Recovery store for quick notes in the app data folder. Notes are written there while
+//editing, so they survive a crash. Each note is a small file with the hash of its HTML,
+//the HTML itself is a zlib compressed blob named by that hash. Equal notes share a blob,
+//and a note is only read and decompressed when its tab is opened
+class NoteStore
+{
+public:
+    static const QString SUFFIX;
+
+    NoteStore();
+    QString create();
+    QString idOf(QString path);
+    QString pathOf(QString id);
+    bool contains(QString path);
+    QStringList notes(QStringList order);
+    void collect();
+    static bool isNote(QString path);
+    static QString read(QString path);
+    static bool write(QString path, QString html);
+
+private:
+    QString dir;
+    void migrate();
+    static QString directory();
+    static QString blobOf(QString path, QByteArray hash);
+};
+
+#endif // NOTESTORE_H
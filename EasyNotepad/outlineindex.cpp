@@ -0,0 +1,192 @@
+#include "outlineindex.h"
+
+#include <algorithm>
+
+//Longest heading title that is shown
+#define MAX_TITLE 80
+
+OutlineIndex::OutlineIndex(QObject *parent) : QObject(parent)
+{
+    blockCount = 0;
+}
+
+//Index another document. Plain text documents have no headings, they get nullptr
+void OutlineIndex::setDocument(QTextDocument *document){
+    if(document == this->document)
+        return;
+
+    if(!this->document.isNull())
+        disconnect(this->document, &QTextDocument::contentsChange, this, &OutlineIndex::contentsChange);
+
+    this->document = document;
+    if(document != nullptr)
+        connect(document, &QTextDocument::contentsChange, this, &OutlineIndex::contentsChange);
+
+    rebuild();
+    emit changed();
+}
+
+void OutlineIndex::rebuild(){
+    list.clear();
+    blockCount = 0;
+    if(document.isNull())
+        return;
+
+    blockCount = document->blockCount();
+    int number = 0;
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next(), number++){
+        Heading heading;
+        if(headingOf(block, &heading)){
+            heading.block = number;
+            list.append(heading);
+        }
+    }
+}
+
+bool OutlineIndex::headingOf(const QTextBlock &block, Heading *heading){
+    int level = block.blockFormat().headingLevel();
+    if(level <= 0)
+        return false;
+
+    heading->level = level;
+    heading->title = block.text().simplified().left(MAX_TITLE);
+    return true;
+}
+
+//Index of the first heading after the block
+int OutlineIndex::firstAfter(int block){
+    Heading key;
+    key.block = block;
+    return std::upper_bound(list.begin(), list.end(), key, [](const Heading &a, const Heading &b) {
+        return a.block < b.block;
+    }) - list.begin();
+}
+
+//Rescan the blocks of an edit. Changes (e.g. of a title) are signaled, moved headings are not
+void OutlineIndex::contentsChange(int position, int removed, int added){
+    Q_UNUSED(removed)
+    if(document.isNull())
+        return;
+
+    int last = document->characterCount() - 1;
+    QTextBlock first = document->findBlock(qBound(0, position, last));
+    int from = first.blockNumber();
+    int to = document->findBlock(qBound(0, position + added, last)).blockNumber();
+    int delta = document->blockCount() - blockCount;
+    int oldTo = to - delta; //Last block of the edit before it was made
+    blockCount = document->blockCount();
+
+    if(from < 0 || oldTo < from){
+        rebuild();
+        emit changed();
+        return;
+    }
+
+    int begin = firstAfter(from - 1);
+    int end = firstAfter(oldTo);
+    for(int i = end; i < list.size(); i++)
+        list[i].block += delta;
+
+    QVector<Heading> found;
+    QTextBlock block = first;
+    for(int i = from; i <= to && block.isValid(); i++, block = block.next()){
+        Heading heading;
+        if(headingOf(block, &heading)){
+            heading.block = i;
+            found.append(heading);
+        }
+    }
+
+    bool same = found.size() == end - begin;
+    for(int i = 0; same && i < found.size(); i++)
+        same = found[i].level == list[begin + i].level && found[i].title == list[begin + i].title;
+
+    if(same){
+        for(int i = 0; i < found.size(); i++)
+            list[begin + i].block = found[i].block;
+        return;
+    }
+
+    list.remove(begin, end - begin);
+    for(int i = 0; i < found.size(); i++)
+        list.insert(begin + i, found[i]);
+    emit changed();
+}
+
+QVector<OutlineIndex::Heading> OutlineIndex::headings() {
+    return list;
+}
+
+//Block of a heading, found in O(log n)
+QTextBlock OutlineIndex::block(int index){
+    if(document.isNull() || index < 0 || index >= list.size())
+        return QTextBlock();
+
+    return document->findBlockByNumber(list[index].block);
+}
+
+//Index after the last heading of the section of a heading
+int OutlineIndex::sectionEnd(int index){
+    int end = index + 1;
+    while(end < list.size() && list[end].level > list[index].level)
+        end++;
+    return end;
+}
+
+bool OutlineIndex::isCollapsed(int index){
+    QTextBlock next = block(index).next();
+    return next.isValid() && !next.isVisible();
+}
+
+//Hide or show the blocks up to the next heading of the same or a higher level
+void OutlineIndex::setCollapsed(int index, bool collapsed){
+    QTextBlock heading = block(index);
+    if(!heading.isValid())
+        return;
+
+    int end = sectionEnd(index);
+    int stop = end < list.size() ? list[end].block : blockCount;
+    QTextBlock block = heading.next();
+    for(int i = list[index].block + 1; i < stop && block.isValid(); i++, block = block.next())
+        block.setVisible(!collapsed);
+
+    //Lay the section out again
+    int from = heading.position();
+    int to = block.isValid() ? block.position() : document->characterCount();
+    document->markContentsDirty(from, to - from);
+    emit changed();
+}
+
+//Show a heading that is in a collapsed section
+void OutlineIndex::expandTo(int index){
+    if(index < 0 || index >= list.size())
+        return;
+
+    int level = list[index].level;
+    for(int i = index - 1; i >= 0 && level > 1; i--){
+        if(list[i].level >= level)
+            continue;
+
+        if(isCollapsed(i))
+            setCollapsed(i, false);
+        level = list[i].level;
+    }
+}
+
+void OutlineIndex::expandAll(){
+    if(document.isNull())
+        return;
+
+    bool hidden = false;
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next()){
+        if(!block.isVisible()){
+            block.setVisible(true);
+            hidden = true;
+        }
+    }
+
+    if(hidden){
+        document->markContentsDirty(0, document->characterCount());
+        emit changed();
+    }
+}
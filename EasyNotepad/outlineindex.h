@@ -0,0 +1,49 @@
+#ifndef OUTLINEINDEX_H
+#define OUTLINEINDEX_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QVector>
+
+//Headings (H1 to H6) of a document, in document order. An edit only rescans the
+//blocks it touched, headings after it only get their block number moved.
+//Sections of a heading can be collapsed, their blocks are hidden and not laid out
+class OutlineIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Heading {
+        int block = 0;
+        int level = 0;
+        QString title;
+    };
+
+    explicit OutlineIndex(QObject *parent = nullptr);
+    void setDocument(QTextDocument *document);
+    QVector<Heading> headings();
+    QTextBlock block(int index);
+    bool isCollapsed(int index);
+    void setCollapsed(int index, bool collapsed);
+    void expandTo(int index);
+    void expandAll();
+
+signals:
+    void changed();
+
+private slots:
+    void contentsChange(int position, int removed, int added);
+
+private:
+    QPointer<QTextDocument> document;
+    QVector<Heading> list;
+    int blockCount; //Of the document as indexed
+    void rebuild();
+    int firstAfter(int block);
+    int sectionEnd(int index);
+    static bool headingOf(const QTextBlock &block, Heading *heading);
+};
+
+#endif // OUTLINEINDEX_H
@@ -0,0 +1,101 @@
+#include "outlinepanel.h"
+
+#include <QMenu>
+
+#include <etab.h>
+
+//Time (ms) after the last change of the headings before the tree is built again
+#define REFRESH_DELAY 100
+
+OutlinePanel::OutlinePanel(QWidget *parent) : QDockWidget("Outline", parent)
+{
+    setObjectName("outlinePanel");
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(REFRESH_DELAY);
+    connect(timer, &QTimer::timeout, this, &OutlinePanel::refresh);
+
+    tree = new QTreeWidget(this);
+    tree->setHeaderHidden(true);
+    tree->setUniformRowHeights(true);
+    tree->setContextMenuPolicy(Qt::CustomContextMenu);
+    setWidget(tree);
+
+    connect(tree, &QTreeWidget::itemClicked, this, &OutlinePanel::itemClicked);
+    connect(tree, &QTreeWidget::itemActivated, this, &OutlinePanel::itemClicked);
+    connect(tree, &QTreeWidget::customContextMenuRequested, this, &OutlinePanel::showMenu);
+    connect(this, &QDockWidget::visibilityChanged, this, &OutlinePanel::outlineChanged);
+}
+
+//Show the headings of another tab
+void OutlinePanel::setTab(ETab *tab){
+    if(!index.isNull())
+        disconnect(index, &OutlineIndex::changed, this, &OutlinePanel::outlineChanged);
+
+    this->tab = tab;
+    index = tab != nullptr ? tab->outline() : nullptr;
+    if(!index.isNull())
+        connect(index, &OutlineIndex::changed, this, &OutlinePanel::outlineChanged);
+
+    refresh();
+}
+
+//Build the tree once typing pauses, and only while it is shown
+void OutlinePanel::outlineChanged(){
+    if(isVisible())
+        timer->start();
+}
+
+void OutlinePanel::refresh(){
+    timer->stop();
+    tree->clear();
+    if(index.isNull() || !isVisible())
+        return;
+
+    //Last item of each open level, a heading goes below the last one of a higher level
+    QVector<QPair<int, QTreeWidgetItem*>> parents;
+    QVector<OutlineIndex::Heading> headings = index->headings();
+    for(int i = 0; i < headings.size(); i++){
+        const OutlineIndex::Heading &heading = headings[i];
+        while(!parents.isEmpty() && parents.last().first >= heading.level)
+            parents.removeLast();
+
+        QTreeWidgetItem *item = parents.isEmpty() ? new QTreeWidgetItem(tree) : new QTreeWidgetItem(parents.last().second);
+        QString title = heading.title.isEmpty() ? QString("(empty heading)") : heading.title;
+        item->setText(0, index->isCollapsed(i) ? "\u25B8 " + title : title);
+        item->setData(0, Qt::UserRole, i);
+        parents.append(qMakePair(heading.level, item));
+    }
+
+    tree->expandAll();
+}
+
+void OutlinePanel::itemClicked(QTreeWidgetItem *item){
+    if(tab.isNull())
+        return;
+
+    tab->gotoHeading(item->data(0, Qt::UserRole).toInt());
+}
+
+void OutlinePanel::showMenu(const QPoint &pos){
+    if(index.isNull())
+        return;
+
+    QTreeWidgetItem *item = tree->itemAt(pos);
+    QMenu menu(this);
+    if(item != nullptr){
+        int heading = item->data(0, Qt::UserRole).toInt();
+        bool collapsed = index->isCollapsed(heading);
+        menu.addAction(collapsed ? "Expand section" : "Collapse section", [this, heading, collapsed]() {
+            if(!index.isNull())
+                index->setCollapsed(heading, !collapsed);
+        });
+    }
+
+    menu.addAction("Expand all", [this]() {
+        if(!index.isNull())
+            index->expandAll();
+    });
+    menu.exec(tree->viewport()->mapToGlobal(pos));
+}
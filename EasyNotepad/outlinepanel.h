@@ -0,0 +1,35 @@
+#ifndef OUTLINEPANEL_H
+#define OUTLINEPANEL_H
+
+#include <QDockWidget>
+#include <QTreeWidget>
+#include <QTimer>
+#include <QPointer>
+#include <outlineindex.h>
+
+class ETab;
+
+//Headings of the selected tab as a tree. Clicking one goes there,
+//the context menu collapses and expands its section in the editor
+class OutlinePanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit OutlinePanel(QWidget *parent = nullptr);
+    void setTab(ETab *tab);
+
+private slots:
+    void outlineChanged();
+    void refresh();
+    void itemClicked(QTreeWidgetItem *item);
+    void showMenu(const QPoint &pos);
+
+private:
+    QPointer<ETab> tab;
+    QPointer<OutlineIndex> index;
+    QTreeWidget *tree;
+    QTimer *timer;
+};
+
+#endif // OUTLINEPANEL_H
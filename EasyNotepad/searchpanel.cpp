@@ -0,0 +1,132 @@
+#include "searchpanel.h"
+
+#include <QGridLayout>
+#include <QFileDialog>
+
+#include <etab.h>
+#include <tabregistry.h>
+
+//Time (ms) after the last change of the query before searching
+#define SEARCH_DELAY 250
+
+SearchPanel::SearchPanel(TabRegistry *registry, QWidget *parent) : QDockWidget("Find in files", parent)
+{
+    setObjectName("searchPanel");
+    this->registry = registry;
+
+    searcher = new FileSearch(this);
+    connect(searcher, &FileSearch::found, this, &SearchPanel::found);
+    connect(searcher, &FileSearch::finished, this, &SearchPanel::finished);
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(SEARCH_DELAY);
+    connect(timer, &QTimer::timeout, this, &SearchPanel::search);
+
+    QWidget *content = new QWidget(this);
+    tbQuery = new QLineEdit(content);
+    tbQuery->setPlaceholderText("Find in open tabs");
+    tbQuery->setClearButtonEnabled(true);
+    tbDirectory = new QLineEdit(content);
+    tbDirectory->setPlaceholderText("And in directory (optional)");
+    btnBrowse = new QPushButton("...", content);
+    cbRegex = new QCheckBox("Regex", content);
+    cbCase = new QCheckBox("Match case", content);
+    lblStatus = new QLabel(content);
+    results = new QTreeWidget(content);
+    results->setHeaderHidden(true);
+    results->setUniformRowHeights(true);
+
+    QGridLayout *layout = new QGridLayout(content);
+    layout->setContentsMargins(3, 3, 3, 3);
+    layout->addWidget(tbQuery, 0, 0, 1, 2);
+    layout->addWidget(cbCase, 0, 2);
+    layout->addWidget(cbRegex, 0, 3);
+    layout->addWidget(tbDirectory, 1, 0);
+    layout->addWidget(btnBrowse, 1, 1);
+    layout->addWidget(lblStatus, 1, 2, 1, 2);
+    layout->addWidget(results, 2, 0, 1, 4);
+    layout->setColumnStretch(0, 1);
+    setWidget(content);
+
+    //A changed query cancels the running search at once, the new one starts when typing pauses
+    connect(tbQuery, &QLineEdit::textChanged, this, &SearchPanel::queryChanged);
+    connect(tbDirectory, &QLineEdit::textChanged, this, &SearchPanel::queryChanged);
+    connect(cbRegex, &QCheckBox::toggled, this, &SearchPanel::queryChanged);
+    connect(cbCase, &QCheckBox::toggled, this, &SearchPanel::queryChanged);
+    connect(tbQuery, &QLineEdit::returnPressed, this, &SearchPanel::search);
+    connect(btnBrowse, &QPushButton::clicked, this, &SearchPanel::browse);
+    connect(results, &QTreeWidget::itemClicked, this, &SearchPanel::itemClicked);
+    connect(results, &QTreeWidget::itemActivated, this, &SearchPanel::itemClicked);
+}
+
+//Show panel, with text as query
+void SearchPanel::open(QString text){
+    if(!text.isEmpty())
+        tbQuery->setText(text);
+
+    show();
+    raise();
+    tbQuery->setFocus();
+    tbQuery->selectAll();
+}
+
+void SearchPanel::queryChanged(){
+    searcher->cancel();
+    timer->start();
+}
+
+void SearchPanel::browse(){
+    QString dir = QFileDialog::getExistingDirectory(this, "Search in directory", tbDirectory->text());
+    if(!dir.isEmpty())
+        tbDirectory->setText(dir);
+}
+
+void SearchPanel::search(){
+    timer->stop();
+    results->clear();
+    groups.clear();
+    hits.clear();
+
+    QList<FileSearch::Source> sources;
+    for(ETab *tab : registry->all()) {
+        sources.append(tab->searchSource());
+    }
+
+    lblStatus->setText(tbQuery->text().isEmpty() ? QString() : QString("Searching..."));
+    searcher->start(tbQuery->text(), cbRegex->isChecked(), cbCase->isChecked(), sources, tbDirectory->text().trimmed());
+}
+
+//Hits of one file
+void SearchPanel::found(QVector<SearchHit> batch){
+    for(const SearchHit &hit : batch) {
+        QTreeWidgetItem *group = groups.value(hit.source);
+        if(group == nullptr){
+            group = new QTreeWidgetItem(results, QStringList() << hit.title);
+            group->setToolTip(0, hit.source);
+            group->setExpanded(true);
+            groups.insert(hit.source, group);
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(group, QStringList() << QString("%1: %2").arg(hit.line + 1).arg(hit.text));
+        item->setData(0, Qt::UserRole, hits.size());
+        hits.append(hit);
+    }
+
+    lblStatus->setText(QString("Searching... %1 matches").arg(hits.size()));
+}
+
+void SearchPanel::finished(int files, int count){
+    if(tbQuery->text().isEmpty())
+        lblStatus->clear();
+    else
+        lblStatus->setText(QString("%1 matches in %2 files").arg(count).arg(files));
+}
+
+void SearchPanel::itemClicked(QTreeWidgetItem *item){
+    QVariant index = item->data(0, Qt::UserRole);
+    if(!index.isValid() || index.toInt() >= hits.size())
+        return;
+
+    emit resultActivated(hits[index.toInt()]);
+}
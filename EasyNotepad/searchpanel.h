@@ -0,0 +1,52 @@
+#ifndef SEARCHPANEL_H
+#define SEARCHPANEL_H
+
+#include <QDockWidget>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QTimer>
+#include <QHash>
+#include <filesearch.h>
+
+class TabRegistry;
+
+//Find in files: searches all open tabs and optionally a directory.
+//Results show up while the search runs, grouped by file
+class SearchPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SearchPanel(TabRegistry *registry, QWidget *parent = nullptr);
+    void open(QString text = QString());
+
+signals:
+    void resultActivated(SearchHit hit);
+
+private slots:
+    void queryChanged();
+    void search();
+    void browse();
+    void found(QVector<SearchHit> batch);
+    void finished(int files, int count);
+    void itemClicked(QTreeWidgetItem *item);
+
+private:
+    TabRegistry *registry;
+    FileSearch *searcher;
+    QTimer *timer;
+    QLineEdit *tbQuery;
+    QLineEdit *tbDirectory;
+    QCheckBox *cbRegex;
+    QCheckBox *cbCase;
+    QPushButton *btnBrowse;
+    QLabel *lblStatus;
+    QTreeWidget *results;
+    QHash<QString, QTreeWidgetItem*> groups; //By source
+    QVector<SearchHit> hits;
+};
+
+#endif // SEARCHPANEL_H
@@ -0,0 +1,69 @@
+# Sources of the editor, shared by the app and the benchmark. The app adds main.cpp
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/autosavescheduler.cpp \
+    $$PWD/changetracker.cpp \
+    $$PWD/colorpicker.cpp \
+    $$PWD/documentexporter.cpp \
+    $$PWD/documentstats.cpp \
+    $$PWD/editjournal.cpp \
+    $$PWD/etab.cpp \
+    $$PWD/fileclassifier.cpp \
+    $$PWD/fileloader.cpp \
+    $$PWD/filesaver.cpp \
+    $$PWD/filesearch.cpp \
+    $$PWD/filestreamer.cpp \
+    $$PWD/findbar.cpp \
+    $$PWD/findengine.cpp \
+    $$PWD/imageloader.cpp \
+    $$PWD/largefileview.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/markdownimporter.cpp \
+    $$PWD/nativeformat.cpp \
+    $$PWD/notestore.cpp \
+    $$PWD/outlineindex.cpp \
+    $$PWD/outlinepanel.cpp \
+    $$PWD/searchpanel.cpp \
+    $$PWD/tabregistry.cpp \
+    $$PWD/textdecoder.cpp \
+    $$PWD/updatecoalescer.cpp \
+    $$PWD/urlpicker.cpp
+
+HEADERS += \
+    $$PWD/autosavescheduler.h \
+    $$PWD/changetracker.h \
+    $$PWD/colorpicker.h \
+    $$PWD/documentexporter.h \
+    $$PWD/documentstats.h \
+    $$PWD/editjournal.h \
+    $$PWD/etab.h \
+    $$PWD/fileclassifier.h \
+    $$PWD/fileloader.h \
+    $$PWD/filesaver.h \
+    $$PWD/filesearch.h \
+    $$PWD/filestreamer.h \
+    $$PWD/findbar.h \
+    $$PWD/findengine.h \
+    $$PWD/imageloader.h \
+    $$PWD/largefileview.h \
+    $$PWD/mainwindow.h \
+    $$PWD/markdownimporter.h \
+    $$PWD/nativeformat.h \
+    $$PWD/notestore.h \
+    $$PWD/outlineindex.h \
+    $$PWD/outlinepanel.h \
+    $$PWD/searchpanel.h \
+    $$PWD/tabregistry.h \
+    $$PWD/textdecoder.h \
+    $$PWD/updatecoalescer.h \
+    $$PWD/urlpicker.h
+
+FORMS += \
+    $$PWD/colorpicker.ui \
+    $$PWD/etab.ui \
+    $$PWD/mainwindow.ui \
+    $$PWD/urlpicker.ui
+
+RESOURCES += $$PWD/resources.qrc
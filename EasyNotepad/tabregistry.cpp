@@ -0,0 +1,96 @@
+#include "tabregistry.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <etab.h>
+
+TabRegistry::TabRegistry(QTabWidget *tabs, QObject *parent) : QObject(parent)
+{
+    this->tabs = tabs;
+}
+
+void TabRegistry::add(ETab *tab){
+    Entry entry;
+    entry.tab = tab;
+    entry.id = tab->objectName();
+    entry.opened = QDateTime::currentMSecsSinceEpoch();
+    entries.insert(tab, entry);
+    ids.insert(entry.id, tab);
+
+    connect(tab, &QObject::destroyed, this, &TabRegistry::removed);
+    update(tab);
+}
+
+//File of the tab changed, e.g. after save as
+void TabRegistry::update(ETab *tab){
+    if(!entries.contains(tab))
+        return;
+
+    Entry &entry = entries[tab];
+    if(paths.value(entry.path) == tab)
+        paths.remove(entry.path);
+    if(aliases.value(entry.alias) == tab)
+        aliases.remove(entry.alias);
+
+    //Canonical once here, instead of on every lookup
+    entry.alias = tab->fileExists() ? tab->getFileName() : tab->getNotePath();
+    entry.path = entry.alias.isEmpty() ? QString() : canonical(entry.alias);
+    if(!entry.path.isEmpty()){
+        paths.insert(entry.path, tab);
+        aliases.insert(entry.alias, tab);
+    }
+}
+
+//Tab was opened by the user
+void TabRegistry::touch(ETab *tab){
+    if(!entries.contains(tab))
+        return;
+
+    entries[tab].used = QDateTime::currentMSecsSinceEpoch();
+    recent.removeOne(tab);
+    recent.prepend(tab);
+}
+
+ETab* TabRegistry::current() { return at(tabs->currentIndex()); }
+ETab* TabRegistry::at(int index) { return qobject_cast<ETab*>(tabs->widget(index)); }
+ETab* TabRegistry::byId(QString id) { return ids.value(id); }
+TabRegistry::Entry TabRegistry::info(ETab *tab) { return entries.value(tab); }
+QList<ETab*> TabRegistry::mru() { return recent; }
+int TabRegistry::count() { return entries.size(); }
+
+//Tab of the file. Paths written another way than the tab has it are made canonical first
+ETab* TabRegistry::byPath(QString path){
+    if(ETab *tab = aliases.value(path))
+        return tab;
+    return path.isEmpty() ? nullptr : paths.value(canonical(path));
+}
+
+//Tabs in the order they are shown
+QList<ETab*> TabRegistry::all(){
+    QList<ETab*> result;
+    for(int i = 0; i < tabs->count(); i++) {
+        ETab *tab = at(i);
+        if(tab != nullptr)
+            result.append(tab);
+    }
+    return result;
+}
+
+//Only the pointer is used, the tab is already half destroyed
+void TabRegistry::removed(QObject *object){
+    Entry entry = entries.take(object);
+    ids.remove(entry.id);
+    if(paths.value(entry.path) == entry.tab)
+        paths.remove(entry.path);
+    if(aliases.value(entry.alias) == entry.tab)
+        aliases.remove(entry.alias);
+    recent.removeOne(entry.tab);
+}
+
+//Same file, however it is written. Files that don't exist yet keep their absolute path
+QString TabRegistry::canonical(QString path){
+    QFileInfo info(path);
+    QString result = info.canonicalFilePath();
+    return result.isEmpty() ? info.absoluteFilePath() : result;
+}
@@ -0,0 +1,53 @@
+#ifndef TABREGISTRY_H
+#define TABREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTabWidget>
+
+class ETab;
+
+//Index of the open tabs by id, file path and tab index, with the order they were used in.
+//Tabs leave the registry when they are deleted
+class TabRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        ETab *tab = nullptr;
+        QString id;
+        QString path; //File, or recovery file of a quick note. Canonical
+        QString alias; //The same path as the tab has it
+        qint64 opened = 0;
+        qint64 used = 0;
+    };
+
+    explicit TabRegistry(QTabWidget *tabs, QObject *parent = nullptr);
+    void add(ETab *tab);
+    void update(ETab *tab);
+    void touch(ETab *tab);
+    ETab* current();
+    ETab* at(int index);
+    ETab* byId(QString id);
+    ETab* byPath(QString path);
+    Entry info(ETab *tab);
+    QList<ETab*> all();
+    QList<ETab*> mru();
+    int count();
+
+private slots:
+    void removed(QObject *object);
+
+private:
+    QTabWidget *tabs;
+    QHash<QObject*, Entry> entries;
+    QHash<QString, ETab*> ids;
+    QHash<QString, ETab*> paths;
+    QHash<QString, ETab*> aliases; //Most lookups use the path of the tab itself, no syscall for those
+    QList<ETab*> recent; //Most recently used first
+    static QString canonical(QString path);
+};
+
+#endif // TABREGISTRY_H
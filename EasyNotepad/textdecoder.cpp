@@ -0,0 +1,183 @@
+#include "textdecoder.h"
+
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+
+//Bytes looked at to tell UTF-16 without BOM apart
+#define UTF16_PROBE 4096
+
+//Decode data. With partial set, data is the head of a file and may end in the middle of a character
+TextDecoder::Result TextDecoder::decode(const QByteArray &data, bool partial){
+    Result result;
+
+    //BOM of UTF-8, UTF-16 or UTF-32
+    QTextCodec *bom = QTextCodec::codecForUtfText(data, nullptr);
+    if(bom != nullptr && bom->mibEnum() == 106){
+        if(decodeUtf8(data.constData() + 3, data.size() - 3, partial, &result.text)){
+            result.encoding = "UTF-8 BOM";
+            return result;
+        }
+    } else if(bom != nullptr){
+        result.text = bom->toUnicode(data);
+        result.encoding = bom->name();
+        return result;
+    }
+
+    //Zero bytes are valid UTF-8, so look for UTF-16 first
+    QTextCodec *codec = nullptr;
+    if(const char *utf16 = looksUtf16(data))
+        codec = QTextCodec::codecForName(utf16);
+
+    if(codec == nullptr && decodeUtf8(data.constData(), data.size(), partial, &result.text)){
+        result.encoding = "UTF-8";
+        return result;
+    }
+
+    if(codec == nullptr)
+        codec = fallback(data);
+
+    result.text = codec->toUnicode(data);
+    result.encoding = codec->name();
+    return result;
+}
+
+//Codec for text that starts with head, the same decode() would use. For text that is
+//decoded piece by piece, e.g. when it is streamed
+QTextCodec *TextDecoder::codecFor(const QByteArray &head){
+    if(QTextCodec *bom = QTextCodec::codecForUtfText(head, nullptr))
+        return bom;
+    if(const char *utf16 = looksUtf16(head))
+        return QTextCodec::codecForName(utf16);
+
+    QString text;
+    if(decodeUtf8(head.constData(), head.size(), true, &text))
+        return QTextCodec::codecForMib(106);
+    return fallback(head);
+}
+
+//Charset of HTML, else the locale. Text that isn't UTF-8 is no UTF-8 in a UTF-8 locale either
+QTextCodec *TextDecoder::fallback(const QByteArray &data){
+    QTextCodec *codec = QTextCodec::codecForHtml(data, nullptr);
+    if(codec == nullptr){
+        codec = QTextCodec::codecForLocale();
+        if(codec->mibEnum() == 106)
+            codec = QTextCodec::codecForName("ISO-8859-1");
+    }
+    return codec;
+}
+
+//Validate and decode UTF-8. Returns false at the first invalid sequence
+bool TextDecoder::decodeUtf8(const char *data, int size, bool partial, QString *text){
+    const uchar *src = reinterpret_cast<const uchar*>(data);
+    QString out(size, Qt::Uninitialized); //UTF-16 never needs more units than UTF-8 bytes
+    ushort *dst = reinterpret_cast<ushort*>(out.data());
+    int i = 0;
+
+    while(i < size){
+#ifdef HAVE_SSE2
+        //ASCII: 16 bytes to 16 chars at once
+        const __m128i zero = _mm_setzero_si128();
+        while(i + 16 <= size){
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            uint mask = uint(_mm_movemask_epi8(bytes));
+            if(mask != 0){
+                //Copy the ASCII before the first other byte
+                int ascii = int(qCountTrailingZeroBits(mask));
+                for(int k = 0; k < ascii; k++)
+                    *dst++ = src[i + k];
+                i += ascii;
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(bytes, zero));
+            dst += 16;
+            i += 16;
+        }
+        if(i >= size)
+            break;
+#endif
+
+        uchar b = src[i];
+        if(b < 0x80){
+            *dst++ = b;
+            i++;
+            continue;
+        }
+
+        int trail;
+        uint cp;
+        if(b >= 0xC2 && b <= 0xDF){
+            trail = 1;
+            cp = b & 0x1F;
+        } else if(b >= 0xE0 && b <= 0xEF){
+            trail = 2;
+            cp = b & 0x0F;
+        } else if(b >= 0xF0 && b <= 0xF4){
+            trail = 3;
+            cp = b & 0x07;
+        } else
+            return false;
+
+        //Cut off at the end of the head
+        if(i + trail >= size){
+            if(!partial)
+                return false;
+            for(int k = i + 1; k < size; k++){
+                if((src[k] & 0xC0) != 0x80)
+                    return false;
+            }
+            break;
+        }
+
+        for(int k = 1; k <= trail; k++){
+            uchar c = src[i + k];
+            if((c & 0xC0) != 0x80)
+                return false;
+            cp = (cp << 6) | (c & 0x3F);
+        }
+
+        //Overlong forms, surrogates and code points above U+10FFFF are invalid
+        if((trail == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) || (trail == 3 && (cp < 0x10000 || cp > 0x10FFFF)))
+            return false;
+
+        if(QChar::requiresSurrogates(cp)){
+            *dst++ = QChar::highSurrogate(cp);
+            *dst++ = QChar::lowSurrogate(cp);
+        } else
+            *dst++ = ushort(cp);
+        i += trail + 1;
+    }
+
+    out.truncate(int(dst - reinterpret_cast<ushort*>(out.data())));
+    *text = out;
+    return true;
+}
+
+//UTF-16 without BOM: text in Latin script has a zero byte in most characters, always at
+//the same side. Returns the codec name, or nullptr
+const char *TextDecoder::looksUtf16(const QByteArray &data){
+    int size = qMin(data.size(), UTF16_PROBE) & ~1;
+    if(size < 2)
+        return nullptr;
+
+    int even = 0;
+    int odd = 0;
+    for(int i = 0; i < size; i += 2){
+        if(data[i] == 0)
+            even++;
+        if(data[i + 1] == 0)
+            odd++;
+    }
+
+    int chars = size / 2;
+    if(odd * 10 > chars * 4 && even * 10 < chars)
+        return "UTF-16LE";
+    if(even * 10 > chars * 4 && odd * 10 < chars)
+        return "UTF-16BE";
+    return nullptr;
+}
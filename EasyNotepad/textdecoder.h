@@ -0,0 +1,29 @@
+#ifndef TEXTDECODER_H
+#define TEXTDECODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QTextCodec>
+
+//Detects the encoding of a file and decodes it in the same pass. Text with a BOM uses
+//that, text without one is tried as UTF-8 first (most files are), with runs of ASCII
+//widened 16 bytes at a time. Only text that isn't valid UTF-8 is decoded a second time,
+//with the charset of the HTML or the locale. UTF-16 without BOM is told by its zero bytes
+class TextDecoder
+{
+public:
+    struct Result {
+        QString text;
+        QString encoding; //Name for the status bar
+    };
+
+    static Result decode(const QByteArray &data, bool partial = false);
+    static QTextCodec *codecFor(const QByteArray &head);
+
+private:
+    static QTextCodec *fallback(const QByteArray &data);
+    static bool decodeUtf8(const char *data, int size, bool partial, QString *text);
+    static const char *looksUtf16(const QByteArray &data);
+};
+
+#endif // TEXTDECODER_H
@@ -0,0 +1,81 @@
+#include "updatecoalescer.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+//Used when the screen doesn't tell its refresh rate (Hz)
+#define DEFAULT_REFRESH_RATE 60.0
+
+UpdateCoalescer::UpdateCoalescer(QObject *parent) : QObject(parent)
+{
+    line = 0;
+    col = 0;
+    statusPending = false;
+    formatPending = false;
+    statisticsPending = false;
+    requests = 0;
+    refreshes = 0;
+
+    QScreen *screen = QGuiApplication::primaryScreen();
+    double rate = (screen != nullptr && screen->refreshRate() > 1) ? screen->refreshRate() : DEFAULT_REFRESH_RATE;
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    timer->setInterval(qMax(1, (int)(1000.0 / rate)));
+    connect(timer, &QTimer::timeout, this, &UpdateCoalescer::flush);
+}
+
+void UpdateCoalescer::setStatus(int line, int col){
+    this->line = line;
+    this->col = col;
+    statusPending = true;
+    schedule();
+}
+
+void UpdateCoalescer::setFormat(const QTextCharFormat &format){
+    this->format = format;
+    formatPending = true;
+    schedule();
+}
+
+void UpdateCoalescer::setStatistics(QString text){
+    this->statistics = text;
+    statisticsPending = true;
+    schedule();
+}
+
+//First update of a frame starts the timer, the rest only replace the values
+void UpdateCoalescer::schedule(){
+    requests++;
+    if(!timer->isActive())
+        timer->start();
+}
+
+void UpdateCoalescer::flush(){
+    if(statusPending){
+        statusPending = false;
+        refreshes++;
+        emit statusChanged(line, col);
+    }
+
+    if(formatPending){
+        formatPending = false;
+        refreshes++;
+        emit formatChanged(format);
+    }
+
+    if(statisticsPending){
+        statisticsPending = false;
+        refreshes++;
+        emit statisticsChanged(statistics);
+    }
+}
+
+qint64 UpdateCoalescer::requested() { return requests; }
+qint64 UpdateCoalescer::applied() { return refreshes; }
+qint64 UpdateCoalescer::coalesced() { return requests - refreshes; }
+
+QString UpdateCoalescer::stats() {
+    return QString("UI updates: %1, applied: %2, coalesced: %3").arg(requests).arg(refreshes).arg(coalesced());
+}
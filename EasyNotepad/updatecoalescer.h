@@ -0,0 +1,46 @@
+#ifndef UPDATECOALESCER_H
+#define UPDATECOALESCER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QTextCharFormat>
+
+//Collects cursor and format updates of the editor and passes on only the last
+//of each, at most once per display frame
+class UpdateCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UpdateCoalescer(QObject *parent = nullptr);
+    void setStatus(int line, int col);
+    void setFormat(const QTextCharFormat &format);
+    void setStatistics(QString text);
+    qint64 requested();
+    qint64 applied();
+    qint64 coalesced();
+    QString stats();
+
+signals:
+    void statusChanged(int line, int col);
+    void formatChanged(const QTextCharFormat &format);
+    void statisticsChanged(QString text);
+
+private slots:
+    void flush();
+
+private:
+    QTimer *timer;
+    int line;
+    int col;
+    QTextCharFormat format;
+    QString statistics;
+    bool statusPending;
+    bool formatPending;
+    bool statisticsPending;
+    qint64 requests;
+    qint64 refreshes;
+    void schedule();
+};
+
+#endif // UPDATECOALESCER_H